@@ -0,0 +1,102 @@
+// Vérification de la garantie de reserve() : après reserve() et un premier calcul, price() sur le même pricer ne fait plus aucune
+// allocation, pour un nouveau marché comme pour un nouveau spot. Les opérateurs new globaux sont remplacés par des versions qui comptent.
+// Compilation : g++ -std=c++17 -O2 -pthread alloc_check.cpp -o alloc_check && ./alloc_check (code de retour 1 si une allocation apparaît)
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <new>
+#define main edp_main
+#include "code.cpp"
+#undef main
+
+static std::atomic<long> allocations{0};
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, std::align_val_t align) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = nullptr;
+    if (posix_memalign(&p, std::max(static_cast<std::size_t>(align), sizeof(void*)), size ? size : 1) == 0) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new[](std::size_t size, std::align_val_t align) { return operator new(size, align); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" // Les new ci-dessus allouent par malloc : free est le bon appariement
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+struct Case {
+    const char* name;
+    FiniteDifferencePricer::GridSettings grid;
+    FiniteDifferencePricer::Parameters contract;
+    long allowed; // Allocations permises par résolution : une résolution partagée crée ses grid.threads - 1 threads (et leur vecteur) à chaque appel
+};
+
+int main() {
+    typedef FiniteDifferencePricer P;
+    std::vector<Case> cases;
+    const P::Parameters atm{0, 100, 100, 0.05, 0.2, 1};
+    const P::Parameters calm{0, 100, 100, 0.05, 0.02, 0.005}; // Grandes grilles explicites : M minimal de la stabilité de l'ordre de 1000
+    auto add = [&](const char* name, P::Scheme scheme, int N, const P::Parameters& contract) -> P::GridSettings& {
+        Case c{name, P::GridSettings(), contract, 0};
+        c.grid.scheme = scheme;
+        c.grid.N = N;
+        cases.push_back(c);
+        return cases.back().grid;
+    };
+    add("explicite", P::Scheme::Explicit, 200, atm);
+    add("explicite par tuiles", P::Scheme::Explicit, 16384, calm);
+    add("implicite", P::Scheme::Implicit, 2000, atm);
+    add("crank-nicolson", P::Scheme::CrankNicolson, 2000, atm);
+    add("crank-nicolson N = 777", P::Scheme::CrankNicolson, 777, atm); // Remontée générale (hors grilles prédéfinies)
+    add("resserre", P::Scheme::CrankNicolson, 500, atm).spacing = P::Spacing::Stretched;
+    add("sensibilites", P::Scheme::CrankNicolson, 400, atm).sensitivities = true;
+    add("sensibilites explicite", P::Scheme::Explicit, 100, atm).sensitivities = true;
+    add("tolerance", P::Scheme::CrankNicolson, 100, atm).tolerance = 1e-3;
+    add("americain", P::Scheme::CrankNicolson, 500, atm).exercise = P::Exercise::American;
+    add("float", P::Scheme::CrankNicolson, 500, atm).precision = P::Precision::Float;
+    P::GridSettings& partitioned = add("crank-nicolson 2 threads", P::Scheme::CrankNicolson, 20000, atm);
+    partitioned.threads = 2;
+    partitioned.M = 200;
+    cases.back().allowed = 2;
+    P::GridSettings& halo = add("explicite 2 threads", P::Scheme::Explicit, 20000, calm);
+    halo.threads = 2;
+    cases.back().allowed = 2;
+
+    std::setvbuf(stdout, nullptr, _IOLBF, 0);
+    int failures = 0;
+    for (const Case& c : cases) {
+        const P::Parameters& base = c.contract;
+        P pricer(base);
+        pricer.price(base, c.grid); // Premier calcul : M de la grille, tailles des buffers
+        pricer.reserve(4 * c.grid.N, 2 * pricer.timeSteps()); // Le mode tolérance raffine jusqu'à 4N
+        pricer.price(base, c.grid);
+
+        const int ticks = 4;
+        const long before = allocations.load();
+        for (int i = 1; i <= ticks; i++) {
+            P::Parameters p = base;
+            p.sigma *= 1.0 + 0.01 * i; // Nouveau marché : nouvelle résolution
+            p.r -= 0.001 * i;
+            pricer.price(p, c.grid);
+            pricer.reprice(base.S0 + 0.5 * i); // Nouveau spot : lecture de la solution, ou nouvelle résolution (tolérance)
+        }
+        const long counted = allocations.load() - before;
+        const long allowed = c.allowed * ticks; // Les nouveaux spots d'une grille uniforme ne refont pas de résolution
+        const bool ok = counted <= allowed;
+        std::printf("%-26s %3ld allocations pour %d calculs (permis : %ld) %s\n", c.name, counted, 2 * ticks, allowed, ok ? "ok" : "ECHEC");
+        if (!ok) failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
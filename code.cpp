@@ -3,14 +3,502 @@
 #include <cmath>
 #include <algorithm>
 #include <limits>
+#include <thread>
+#include <atomic>
+#include <new>
+#include <cstddef>
+#include <string>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <charconv>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define EDP_MMAP 1
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <cerrno>
+#define EDP_SERVICE 1 // Mode service (--serve) sur sockets POSIX
+#endif
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define EDP_X86_KERNELS 1
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define EDP_NEON_KERNELS 1
+#endif
+#ifdef __CUDACC__
+#include <cuda_runtime.h>
+#define EDP_GPU 1 // Moteur GPU des portefeuilles : compiler avec nvcc -x cu code.cpp
+#endif
+// Instrumentation (compiler avec -DEDP_INSTRUMENTATION) : temps de chaque phase, pas et noeuds calculés, trace au format Chrome.
+// Sans ce drapeau les points de mesure disparaissent à la compilation et les compteurs restent à zéro.
+#ifdef EDP_INSTRUMENTATION
+#define EDP_PHASE(phase) PhaseTimer phaseTimer(instrumentation, Phase::phase)
+#define EDP_PRICING_CALL() CallScope callScope(instrumentation)
+#else
+#define EDP_PHASE(phase) ((void)0)
+#define EDP_PRICING_CALL() ((void)0)
+#endif
 
-// Ce programme permet de calculer le prix d'une option européenne (pas d'exercice prématuré comme avec une option américaine ou bermudéenne) via la méthode des différences finies explicites de Black-Scholes.
-// La méthode des différences finies est utilisée pour évaluer le prix de la call option, tandis que pour le put on utilise la parité put-call.
+// Ce programme permet de calculer le prix d'une option européenne, américaine ou bermudéenne via la méthode des différences finies de Black-Scholes.
+// Trois schémas temporels sont disponibles : explicite (contraint par la condition de stabilité), implicite et Crank-Nicolson (inconditionnellement stables, résolus par l'algorithme de Thomas).
+// La méthode des différences finies résout directement le contrat : call ou put, classique, digital (cash-or-nothing) ou désactivé à la hausse par une barrière.
+// L'exercice anticipé est une projection sur la valeur d'exercice (schéma explicite) ou un solveur de Thomas projeté de Brennan-Schwartz (schémas implicites).
 // Nous faisons les hypothèses suivantes:
-// - Pas de dividende
+// - Dividendes : taux continu q, et dividendes en numéraire détachés à dates fixes (saut du sous-jacent de S à S - D)
 // - Le prix de l'actif ne dépasse pas S_max (qui permet de discrétisé l'intervalle).
 // Le programme permet non seulement à l'utilisateur de renseigner les caractéristiques de l'option, mais aussi de choisir la précision de l'analyse (pas spatial et temporel).
-// Les Grecques (Delta et Gamma) sont calculés à la fin afin de donner des indications concernant les sensibilités du prix de l'option.
+// Les Grecques (Delta, Gamma et Theta) sont calculés à la fin afin de donner des indications concernant les sensibilités du prix de l'option.
+
+// Allocateur aligné sur une ligne de cache (64 octets) : les tableaux de coefficients commencent sur une frontière de ligne de cache.
+template <typename T, std::size_t Align = 64>
+struct AlignedAllocator {
+    using value_type = T;
+    template <typename U> struct rebind { using other = AlignedAllocator<U, Align>; };
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+    }
+    void deallocate(T* p, std::size_t) {
+        ::operator delete(p, std::align_val_t(Align));
+    }
+
+    template <typename U> bool operator==(const AlignedAllocator<U, Align>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Align>&) const { return false; }
+};
+
+using AlignedVector = std::vector<double, AlignedAllocator<double>>;
+using AlignedFloatVector = std::vector<float, AlignedAllocator<float>>;
+
+// Noyaux du stencil à trois points : out[j] = a[j]*in[j-1] + b[j]*in[j] + c[j]*in[j+1] pour j dans [begin, end).
+// Les noeuds de bord (j=0 et j=N) ne passent jamais par ces noyaux : ils sont fixés à part par les conditions aux limites.
+// Les versions vectorielles terminent le tableau avec std::fma dans le même ordre que les voies SIMD,
+// si bien qu'un noeud donne le même résultat quelle que soit sa position dans l'intervalle traité.
+typedef void (*StencilKernel)(const double* a, const double* b, const double* c, const double* in, double* out, int begin, int end);
+
+static void stencilScalar(const double* a, const double* b, const double* c, const double* in, double* out, int begin, int end) {
+    for (int j = begin; j < end; j++) {
+        out[j] = a[j] * in[j - 1] + b[j] * in[j] + c[j] * in[j + 1];
+    }
+}
+
+// Noyaux de taille fixe des grilles prédéfinies (voir FiniteDifferencePricer::fixedSizes) : les noeuds [1, FixedN) sont connus à la
+// compilation, la boucle peut être déroulée et vectorisée sans test de fin de tableau. Mêmes opérations que le noyau de taille quelconque,
+// donc mêmes résultats ; les buffers ne se recouvrent jamais (__restrict).
+typedef void (*FixedStencilKernel)(const double* a, const double* b, const double* c, const double* in, double* out);
+
+template <int FixedN>
+static void stencilScalarFixed(const double* __restrict a, const double* __restrict b, const double* __restrict c, const double* __restrict in, double* __restrict out) {
+    constexpr int body = 1 + (FixedN - 1) / 4 * 4; // Nombre de tours multiple de 4 : l'auto-vectorisation de -O2 n'accepte que les boucles sans reste
+    for (int j = 1; j < body; j++) {
+        out[j] = a[j] * in[j - 1] + b[j] * in[j] + c[j] * in[j + 1];
+    }
+    for (int j = body; j < FixedN; j++) {
+        out[j] = a[j] * in[j - 1] + b[j] * in[j] + c[j] * in[j + 1];
+    }
+}
+
+// Noyaux de la passe adjointe : accumulent dans sums[0] et sums[1] les sommes sur j de
+//   rb[j] * (sl[j] * (v[j-1] - v[j]) + sh[j] * (v[j+1] - v[j]))                (contribution à Vega)
+//   rb[j] * (rl[j] * (v[j-1] - v[j]) + rh[j] * (v[j+1] - v[j]) - dt * v[j])    (contribution à Rho)
+// avec v = (1-th) * Um + th * Um1, pour j dans [begin, end).
+typedef void (*AdjointKernel)(const double* rb, const double* sl, const double* sh, const double* rl, const double* rh, const double* Um, const double* Um1, double th, double dt, int begin, int end, double* sums);
+
+static void adjointScalar(const double* rb, const double* sl, const double* sh, const double* rl, const double* rh, const double* Um, const double* Um1, double th, double dt, int begin, int end, double* sums) {
+    double s[4] = {0.0, 0.0, 0.0, 0.0}, r[4] = {0.0, 0.0, 0.0, 0.0}; // Accumulateurs indépendants pour ne pas être limité par la latence de l'addition
+    for (int j = begin; j < end; j++) {
+        const double vm = (1.0 - th) * Um[j - 1] + th * Um1[j - 1];
+        const double v0 = (1.0 - th) * Um[j] + th * Um1[j];
+        const double vp = (1.0 - th) * Um[j + 1] + th * Um1[j + 1];
+        const double em = vm - v0, ep = vp - v0;
+        s[j & 3] += rb[j] * (sl[j] * em + sh[j] * ep);
+        r[j & 3] += rb[j] * (rl[j] * em + rh[j] * ep - dt * v0);
+    }
+    sums[0] += (s[0] + s[1]) + (s[2] + s[3]);
+    sums[1] += (r[0] + r[1]) + (r[2] + r[3]);
+}
+
+// Noyaux du calcul en simple précision (GridSettings::precision) : coefficients en float, prix de type Real (float, ou double pour
+// la précision mixte), calcul dans le type Real. Le stencil y est écrit sous forme d'incrément :
+//   out[j] = keep*in[j] + a[j]*(in[j-1] - in[j]) + c[j]*(in[j+1] - in[j]) + e[j]*in[j]     (keep = 1, ou 0 pour l'incrément seul)
+// Sous la forme a*in[j-1] + b*in[j] + c*in[j+1], l'arrondi de b = 1 - r*dt + ... en float (6e-8) s'ajouterait à chaque pas et
+// s'accumulerait sur les M pas ; ici seul l'incrément porte l'erreur relative du float, et les différences de prix voisins sont exactes.
+template <class Real>
+using IncrementKernel = void (*)(const float* a, const float* c, const float* e, const Real* in, Real* out, int begin, int end, Real keep);
+
+// Multiplication-addition du noyau portable : fma matériel seulement s'il est rapide (FP_FAST_FMA / FP_FAST_FMAF) ; sinon, sur x86-64
+// sans -mfma par exemple, std::fma appellerait la routine logicielle de la libm à chaque noeud.
+template <class Real>
+static inline Real multiplyAdd(Real x, Real y, Real z) {
+#if defined(FP_FAST_FMA) && defined(FP_FAST_FMAF)
+    return std::fma(x, y, z);
+#else
+    return x * y + z;
+#endif
+}
+
+template <class Real>
+static void incrementScalar(const float* a, const float* c, const float* e, const Real* in, Real* out, int begin, int end, Real keep) {
+    for (int j = begin; j < end; j++) {
+        const Real x = in[j];
+        out[j] = multiplyAdd(keep, x, multiplyAdd(Real(c[j]), in[j + 1] - x, multiplyAdd(Real(a[j]), in[j - 1] - x, Real(e[j]) * x)));
+    }
+}
+
+#ifdef EDP_X86_KERNELS
+// Corps des noyaux développés en ligne dans leur version de taille quelconque et dans leurs versions de taille fixe
+__attribute__((target("avx2,fma"), always_inline))
+static inline void stencilAvx2Body(const double* a, const double* b, const double* c, const double* in, double* out, int begin, int end) {
+    int j = begin;
+    for (; j + 8 <= end; j += 8) { // Deux vecteurs indépendants par itération pour recouvrir la latence des FMA
+        __m256d v0 = _mm256_mul_pd(_mm256_loadu_pd(a + j), _mm256_loadu_pd(in + j - 1));
+        __m256d v1 = _mm256_mul_pd(_mm256_loadu_pd(a + j + 4), _mm256_loadu_pd(in + j + 3));
+        v0 = _mm256_fmadd_pd(_mm256_loadu_pd(b + j), _mm256_loadu_pd(in + j), v0);
+        v1 = _mm256_fmadd_pd(_mm256_loadu_pd(b + j + 4), _mm256_loadu_pd(in + j + 4), v1);
+        v0 = _mm256_fmadd_pd(_mm256_loadu_pd(c + j), _mm256_loadu_pd(in + j + 1), v0);
+        v1 = _mm256_fmadd_pd(_mm256_loadu_pd(c + j + 4), _mm256_loadu_pd(in + j + 5), v1);
+        _mm256_storeu_pd(out + j, v0);
+        _mm256_storeu_pd(out + j + 4, v1);
+    }
+    for (; j < end; j++) {
+        out[j] = std::fma(c[j], in[j + 1], std::fma(b[j], in[j], a[j] * in[j - 1]));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void stencilAvx2(const double* a, const double* b, const double* c, const double* in, double* out, int begin, int end) {
+    stencilAvx2Body(a, b, c, in, out, begin, end);
+}
+
+template <int FixedN>
+__attribute__((target("avx2,fma")))
+static void stencilAvx2Fixed(const double* a, const double* b, const double* c, const double* in, double* out) {
+    stencilAvx2Body(a, b, c, in, out, 1, FixedN);
+}
+
+__attribute__((target("avx512f"), always_inline))
+static inline void stencilAvx512Body(const double* a, const double* b, const double* c, const double* in, double* out, int begin, int end) {
+    int j = begin;
+    for (; j + 16 <= end; j += 16) {
+        __m512d v0 = _mm512_mul_pd(_mm512_loadu_pd(a + j), _mm512_loadu_pd(in + j - 1));
+        __m512d v1 = _mm512_mul_pd(_mm512_loadu_pd(a + j + 8), _mm512_loadu_pd(in + j + 7));
+        v0 = _mm512_fmadd_pd(_mm512_loadu_pd(b + j), _mm512_loadu_pd(in + j), v0);
+        v1 = _mm512_fmadd_pd(_mm512_loadu_pd(b + j + 8), _mm512_loadu_pd(in + j + 8), v1);
+        v0 = _mm512_fmadd_pd(_mm512_loadu_pd(c + j), _mm512_loadu_pd(in + j + 1), v0);
+        v1 = _mm512_fmadd_pd(_mm512_loadu_pd(c + j + 8), _mm512_loadu_pd(in + j + 9), v1);
+        _mm512_storeu_pd(out + j, v0);
+        _mm512_storeu_pd(out + j + 8, v1);
+    }
+    for (; j < end; j++) {
+        out[j] = std::fma(c[j], in[j + 1], std::fma(b[j], in[j], a[j] * in[j - 1]));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void stencilAvx512(const double* a, const double* b, const double* c, const double* in, double* out, int begin, int end) {
+    stencilAvx512Body(a, b, c, in, out, begin, end);
+}
+
+template <int FixedN>
+__attribute__((target("avx512f")))
+static void stencilAvx512Fixed(const double* a, const double* b, const double* c, const double* in, double* out) {
+    stencilAvx512Body(a, b, c, in, out, 1, FixedN);
+}
+
+__attribute__((target("avx2,fma")))
+static void incrementFloatAvx2(const float* a, const float* c, const float* e, const float* in, float* out, int begin, int end, float keep) {
+    const __m256 k = _mm256_set1_ps(keep);
+    int j = begin;
+    for (; j + 16 <= end; j += 16) { // Huit noeuds par vecteur, deux fois plus qu'en double ; deux vecteurs indépendants par itération
+        const __m256 x0 = _mm256_loadu_ps(in + j), x1 = _mm256_loadu_ps(in + j + 8);
+        __m256 v0 = _mm256_mul_ps(_mm256_loadu_ps(e + j), x0);
+        __m256 v1 = _mm256_mul_ps(_mm256_loadu_ps(e + j + 8), x1);
+        v0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + j), _mm256_sub_ps(_mm256_loadu_ps(in + j - 1), x0), v0);
+        v1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + j + 8), _mm256_sub_ps(_mm256_loadu_ps(in + j + 7), x1), v1);
+        v0 = _mm256_fmadd_ps(_mm256_loadu_ps(c + j), _mm256_sub_ps(_mm256_loadu_ps(in + j + 1), x0), v0);
+        v1 = _mm256_fmadd_ps(_mm256_loadu_ps(c + j + 8), _mm256_sub_ps(_mm256_loadu_ps(in + j + 9), x1), v1);
+        _mm256_storeu_ps(out + j, _mm256_fmadd_ps(k, x0, v0));
+        _mm256_storeu_ps(out + j + 8, _mm256_fmadd_ps(k, x1, v1));
+    }
+    incrementScalar(a, c, e, in, out, j, end, keep);
+}
+
+__attribute__((target("avx2,fma")))
+static void incrementMixedAvx2(const float* a, const float* c, const float* e, const double* in, double* out, int begin, int end, double keep) {
+    const __m256d k = _mm256_set1_pd(keep);
+    int j = begin;
+    for (; j + 8 <= end; j += 8) { // Coefficients lus en float (16 octets pour 4 noeuds) et convertis, calcul en double
+        const __m256d x0 = _mm256_loadu_pd(in + j), x1 = _mm256_loadu_pd(in + j + 4);
+        __m256d v0 = _mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(e + j)), x0);
+        __m256d v1 = _mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(e + j + 4)), x1);
+        v0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + j)), _mm256_sub_pd(_mm256_loadu_pd(in + j - 1), x0), v0);
+        v1 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + j + 4)), _mm256_sub_pd(_mm256_loadu_pd(in + j + 3), x1), v1);
+        v0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(c + j)), _mm256_sub_pd(_mm256_loadu_pd(in + j + 1), x0), v0);
+        v1 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(c + j + 4)), _mm256_sub_pd(_mm256_loadu_pd(in + j + 5), x1), v1);
+        _mm256_storeu_pd(out + j, _mm256_fmadd_pd(k, x0, v0));
+        _mm256_storeu_pd(out + j + 4, _mm256_fmadd_pd(k, x1, v1));
+    }
+    incrementScalar(a, c, e, in, out, j, end, keep);
+}
+
+__attribute__((target("avx512f")))
+static void incrementFloatAvx512(const float* a, const float* c, const float* e, const float* in, float* out, int begin, int end, float keep) {
+    const __m512 k = _mm512_set1_ps(keep);
+    int j = begin;
+    for (; j + 32 <= end; j += 32) {
+        const __m512 x0 = _mm512_loadu_ps(in + j), x1 = _mm512_loadu_ps(in + j + 16);
+        __m512 v0 = _mm512_mul_ps(_mm512_loadu_ps(e + j), x0);
+        __m512 v1 = _mm512_mul_ps(_mm512_loadu_ps(e + j + 16), x1);
+        v0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + j), _mm512_sub_ps(_mm512_loadu_ps(in + j - 1), x0), v0);
+        v1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + j + 16), _mm512_sub_ps(_mm512_loadu_ps(in + j + 15), x1), v1);
+        v0 = _mm512_fmadd_ps(_mm512_loadu_ps(c + j), _mm512_sub_ps(_mm512_loadu_ps(in + j + 1), x0), v0);
+        v1 = _mm512_fmadd_ps(_mm512_loadu_ps(c + j + 16), _mm512_sub_ps(_mm512_loadu_ps(in + j + 17), x1), v1);
+        _mm512_storeu_ps(out + j, _mm512_fmadd_ps(k, x0, v0));
+        _mm512_storeu_ps(out + j + 16, _mm512_fmadd_ps(k, x1, v1));
+    }
+    incrementScalar(a, c, e, in, out, j, end, keep);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d loadWidened512(const float* p) { // Forme masquée de _mm512_cvtps_pd (même instruction ; GCC 12 signale un faux non-initialisé sur la forme simple)
+    return _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps(p));
+}
+
+__attribute__((target("avx512f")))
+static void incrementMixedAvx512(const float* a, const float* c, const float* e, const double* in, double* out, int begin, int end, double keep) {
+    const __m512d k = _mm512_set1_pd(keep);
+    int j = begin;
+    for (; j + 16 <= end; j += 16) {
+        const __m512d x0 = _mm512_loadu_pd(in + j), x1 = _mm512_loadu_pd(in + j + 8);
+        __m512d v0 = _mm512_mul_pd(loadWidened512(e + j), x0);
+        __m512d v1 = _mm512_mul_pd(loadWidened512(e + j + 8), x1);
+        v0 = _mm512_fmadd_pd(loadWidened512(a + j), _mm512_sub_pd(_mm512_loadu_pd(in + j - 1), x0), v0);
+        v1 = _mm512_fmadd_pd(loadWidened512(a + j + 8), _mm512_sub_pd(_mm512_loadu_pd(in + j + 7), x1), v1);
+        v0 = _mm512_fmadd_pd(loadWidened512(c + j), _mm512_sub_pd(_mm512_loadu_pd(in + j + 1), x0), v0);
+        v1 = _mm512_fmadd_pd(loadWidened512(c + j + 8), _mm512_sub_pd(_mm512_loadu_pd(in + j + 9), x1), v1);
+        _mm512_storeu_pd(out + j, _mm512_fmadd_pd(k, x0, v0));
+        _mm512_storeu_pd(out + j + 8, _mm512_fmadd_pd(k, x1, v1));
+    }
+    incrementScalar(a, c, e, in, out, j, end, keep);
+}
+
+__attribute__((target("avx2,fma")))
+static void adjointAvx2(const double* rb, const double* sl, const double* sh, const double* rl, const double* rh, const double* Um, const double* Um1, double th, double dt, int begin, int end, double* sums) {
+    const __m256d w0 = _mm256_set1_pd(1.0 - th), w1 = _mm256_set1_pd(th), vdt = _mm256_set1_pd(dt);
+    __m256d accS = _mm256_setzero_pd(), accR = _mm256_setzero_pd();
+    int j = begin;
+    for (; j + 4 <= end; j += 4) {
+        __m256d vm = _mm256_fmadd_pd(w1, _mm256_loadu_pd(Um1 + j - 1), _mm256_mul_pd(w0, _mm256_loadu_pd(Um + j - 1)));
+        __m256d v0 = _mm256_fmadd_pd(w1, _mm256_loadu_pd(Um1 + j), _mm256_mul_pd(w0, _mm256_loadu_pd(Um + j)));
+        __m256d vp = _mm256_fmadd_pd(w1, _mm256_loadu_pd(Um1 + j + 1), _mm256_mul_pd(w0, _mm256_loadu_pd(Um + j + 1)));
+        __m256d r = _mm256_loadu_pd(rb + j);
+        __m256d em = _mm256_sub_pd(vm, v0), ep = _mm256_sub_pd(vp, v0);
+        __m256d ts = _mm256_fmadd_pd(_mm256_loadu_pd(sh + j), ep, _mm256_mul_pd(_mm256_loadu_pd(sl + j), em));
+        __m256d tr = _mm256_fmadd_pd(_mm256_loadu_pd(rh + j), ep, _mm256_fmsub_pd(_mm256_loadu_pd(rl + j), em, _mm256_mul_pd(vdt, v0)));
+        accS = _mm256_fmadd_pd(r, ts, accS);
+        accR = _mm256_fmadd_pd(r, tr, accR);
+    }
+    double s[4], r[4];
+    _mm256_storeu_pd(s, accS);
+    _mm256_storeu_pd(r, accR);
+    sums[0] += (s[0] + s[1]) + (s[2] + s[3]);
+    sums[1] += (r[0] + r[1]) + (r[2] + r[3]);
+    adjointScalar(rb, sl, sh, rl, rh, Um, Um1, th, dt, j, end, sums);
+}
+
+__attribute__((target("avx512f")))
+static void adjointAvx512(const double* rb, const double* sl, const double* sh, const double* rl, const double* rh, const double* Um, const double* Um1, double th, double dt, int begin, int end, double* sums) {
+    const __m512d w0 = _mm512_set1_pd(1.0 - th), w1 = _mm512_set1_pd(th), vdt = _mm512_set1_pd(dt);
+    __m512d accS = _mm512_setzero_pd(), accR = _mm512_setzero_pd();
+    int j = begin;
+    for (; j + 8 <= end; j += 8) {
+        __m512d vm = _mm512_fmadd_pd(w1, _mm512_loadu_pd(Um1 + j - 1), _mm512_mul_pd(w0, _mm512_loadu_pd(Um + j - 1)));
+        __m512d v0 = _mm512_fmadd_pd(w1, _mm512_loadu_pd(Um1 + j), _mm512_mul_pd(w0, _mm512_loadu_pd(Um + j)));
+        __m512d vp = _mm512_fmadd_pd(w1, _mm512_loadu_pd(Um1 + j + 1), _mm512_mul_pd(w0, _mm512_loadu_pd(Um + j + 1)));
+        __m512d r = _mm512_loadu_pd(rb + j);
+        __m512d em = _mm512_sub_pd(vm, v0), ep = _mm512_sub_pd(vp, v0);
+        __m512d ts = _mm512_fmadd_pd(_mm512_loadu_pd(sh + j), ep, _mm512_mul_pd(_mm512_loadu_pd(sl + j), em));
+        __m512d tr = _mm512_fmadd_pd(_mm512_loadu_pd(rh + j), ep, _mm512_fmsub_pd(_mm512_loadu_pd(rl + j), em, _mm512_mul_pd(vdt, v0)));
+        accS = _mm512_fmadd_pd(r, ts, accS);
+        accR = _mm512_fmadd_pd(r, tr, accR);
+    }
+    double s[8], r[8];
+    _mm512_storeu_pd(s, accS);
+    _mm512_storeu_pd(r, accR);
+    sums[0] += ((s[0] + s[1]) + (s[2] + s[3])) + ((s[4] + s[5]) + (s[6] + s[7]));
+    sums[1] += ((r[0] + r[1]) + (r[2] + r[3])) + ((r[4] + r[5]) + (r[6] + r[7]));
+    adjointScalar(rb, sl, sh, rl, rh, Um, Um1, th, dt, j, end, sums);
+}
+#endif
+
+#ifdef EDP_NEON_KERNELS
+__attribute__((always_inline))
+static inline void stencilNeonBody(const double* a, const double* b, const double* c, const double* in, double* out, int begin, int end) {
+    int j = begin;
+    for (; j + 4 <= end; j += 4) {
+        float64x2_t v0 = vmulq_f64(vld1q_f64(a + j), vld1q_f64(in + j - 1));
+        float64x2_t v1 = vmulq_f64(vld1q_f64(a + j + 2), vld1q_f64(in + j + 1));
+        v0 = vfmaq_f64(v0, vld1q_f64(b + j), vld1q_f64(in + j));
+        v1 = vfmaq_f64(v1, vld1q_f64(b + j + 2), vld1q_f64(in + j + 2));
+        v0 = vfmaq_f64(v0, vld1q_f64(c + j), vld1q_f64(in + j + 1));
+        v1 = vfmaq_f64(v1, vld1q_f64(c + j + 2), vld1q_f64(in + j + 3));
+        vst1q_f64(out + j, v0);
+        vst1q_f64(out + j + 2, v1);
+    }
+    for (; j < end; j++) {
+        out[j] = std::fma(c[j], in[j + 1], std::fma(b[j], in[j], a[j] * in[j - 1]));
+    }
+}
+
+static void stencilNeon(const double* a, const double* b, const double* c, const double* in, double* out, int begin, int end) {
+    stencilNeonBody(a, b, c, in, out, begin, end);
+}
+
+template <int FixedN>
+static void stencilNeonFixed(const double* a, const double* b, const double* c, const double* in, double* out) {
+    stencilNeonBody(a, b, c, in, out, 1, FixedN);
+}
+
+static void incrementFloatNeon(const float* a, const float* c, const float* e, const float* in, float* out, int begin, int end, float keep) {
+    const float32x4_t k = vdupq_n_f32(keep);
+    int j = begin;
+    for (; j + 8 <= end; j += 8) {
+        const float32x4_t x0 = vld1q_f32(in + j), x1 = vld1q_f32(in + j + 4);
+        float32x4_t v0 = vmulq_f32(vld1q_f32(e + j), x0);
+        float32x4_t v1 = vmulq_f32(vld1q_f32(e + j + 4), x1);
+        v0 = vfmaq_f32(v0, vld1q_f32(a + j), vsubq_f32(vld1q_f32(in + j - 1), x0));
+        v1 = vfmaq_f32(v1, vld1q_f32(a + j + 4), vsubq_f32(vld1q_f32(in + j + 3), x1));
+        v0 = vfmaq_f32(v0, vld1q_f32(c + j), vsubq_f32(vld1q_f32(in + j + 1), x0));
+        v1 = vfmaq_f32(v1, vld1q_f32(c + j + 4), vsubq_f32(vld1q_f32(in + j + 5), x1));
+        vst1q_f32(out + j, vfmaq_f32(v0, k, x0));
+        vst1q_f32(out + j + 4, vfmaq_f32(v1, k, x1));
+    }
+    incrementScalar(a, c, e, in, out, j, end, keep);
+}
+
+static void incrementMixedNeon(const float* a, const float* c, const float* e, const double* in, double* out, int begin, int end, double keep) {
+    const float64x2_t k = vdupq_n_f64(keep);
+    int j = begin;
+    for (; j + 4 <= end; j += 4) {
+        const float64x2_t x0 = vld1q_f64(in + j), x1 = vld1q_f64(in + j + 2);
+        float64x2_t v0 = vmulq_f64(vcvt_f64_f32(vld1_f32(e + j)), x0);
+        float64x2_t v1 = vmulq_f64(vcvt_f64_f32(vld1_f32(e + j + 2)), x1);
+        v0 = vfmaq_f64(v0, vcvt_f64_f32(vld1_f32(a + j)), vsubq_f64(vld1q_f64(in + j - 1), x0));
+        v1 = vfmaq_f64(v1, vcvt_f64_f32(vld1_f32(a + j + 2)), vsubq_f64(vld1q_f64(in + j + 1), x1));
+        v0 = vfmaq_f64(v0, vcvt_f64_f32(vld1_f32(c + j)), vsubq_f64(vld1q_f64(in + j + 1), x0));
+        v1 = vfmaq_f64(v1, vcvt_f64_f32(vld1_f32(c + j + 2)), vsubq_f64(vld1q_f64(in + j + 3), x1));
+        vst1q_f64(out + j, vfmaq_f64(v0, k, x0));
+        vst1q_f64(out + j + 2, vfmaq_f64(v1, k, x1));
+    }
+    incrementScalar(a, c, e, in, out, j, end, keep);
+}
+
+static void adjointNeon(const double* rb, const double* sl, const double* sh, const double* rl, const double* rh, const double* Um, const double* Um1, double th, double dt, int begin, int end, double* sums) {
+    const float64x2_t w0 = vdupq_n_f64(1.0 - th), w1 = vdupq_n_f64(th), vdt = vdupq_n_f64(dt);
+    float64x2_t accS = vdupq_n_f64(0.0), accR = vdupq_n_f64(0.0);
+    int j = begin;
+    for (; j + 2 <= end; j += 2) {
+        float64x2_t vm = vfmaq_f64(vmulq_f64(w0, vld1q_f64(Um + j - 1)), w1, vld1q_f64(Um1 + j - 1));
+        float64x2_t v0 = vfmaq_f64(vmulq_f64(w0, vld1q_f64(Um + j)), w1, vld1q_f64(Um1 + j));
+        float64x2_t vp = vfmaq_f64(vmulq_f64(w0, vld1q_f64(Um + j + 1)), w1, vld1q_f64(Um1 + j + 1));
+        float64x2_t r = vld1q_f64(rb + j);
+        float64x2_t em = vsubq_f64(vm, v0), ep = vsubq_f64(vp, v0);
+        float64x2_t ts = vfmaq_f64(vmulq_f64(vld1q_f64(sl + j), em), vld1q_f64(sh + j), ep);
+        float64x2_t tr = vfmaq_f64(vsubq_f64(vmulq_f64(vld1q_f64(rl + j), em), vmulq_f64(vdt, v0)), vld1q_f64(rh + j), ep);
+        accS = vfmaq_f64(accS, r, ts);
+        accR = vfmaq_f64(accR, r, tr);
+    }
+    sums[0] += vaddvq_f64(accS);
+    sums[1] += vaddvq_f64(accR);
+    adjointScalar(rb, sl, sh, rl, rh, Um, Um1, th, dt, j, end, sums);
+}
+#endif
+
+// Contrats résolus par la grille (politiques du moteur de FiniteDifferencePricer). Chaque politique fournit, pour le strike K :
+//  - payoff(S, K) à maturité et averaged(a, b, K), sa moyenne sur la maille [a, b] (payoff moyenné de l'extrapolation) ;
+//  - les conditions aux limites, de la forme U = spot + cash * exp(-r*tau) : lowerCash en S=0, upperSpot et upperCash en S=Smax ;
+//  - exerciseBelow : la zone d'exercice anticipé est sous le strike (sens de la substitution de Brennan-Schwartz) ;
+//  - homogeneity : degré d'homogénéité du prix en (S, K), dont se déduit dV/dK (-1 : prix non homogène).
+// Le moteur (remontée en temps, pas explicite et pas theta) est instancié pour chaque politique : payoff et conditions aux limites
+// y sont développés en ligne, sans test sur le type de contrat.
+struct CallPayoff {
+    static double payoff(double S, double K) { return std::max(S - K, 0.0); }
+    static double averaged(double a, double b, double K) {
+        if (K <= a) return 0.5 * (a + b) - K;
+        if (K >= b) return 0.0;
+        return 0.5 * (b - K) * (b - K) / (b - a);
+    }
+    static double lowerCash(double) { return 0.0; }
+    static double upperSpot(double Smax) { return Smax; }
+    static double upperCash(double K) { return -K; }
+    static constexpr bool exerciseBelow = false;
+    static constexpr int homogeneity = 1;
+};
+
+struct PutPayoff {
+    static double payoff(double S, double K) { return std::max(K - S, 0.0); }
+    static double averaged(double a, double b, double K) { // max(K - S, 0) = max(S - K, 0) + K - S
+        return CallPayoff::averaged(a, b, K) + K - 0.5 * (a + b);
+    }
+    static double lowerCash(double K) { return K; }
+    static double upperSpot(double) { return 0.0; }
+    static double upperCash(double) { return 0.0; }
+    static constexpr bool exerciseBelow = true;
+    static constexpr int homogeneity = 1;
+};
+
+struct DigitalCallPayoff { // Cash-or-nothing : 1 si S > K à maturité
+    static double payoff(double S, double K) { return S > K ? 1.0 : (S == K ? 0.5 : 0.0); }
+    static double averaged(double a, double b, double K) { return (b - std::min(std::max(K, a), b)) / (b - a); }
+    static double lowerCash(double) { return 0.0; }
+    static double upperSpot(double) { return 0.0; }
+    static double upperCash(double) { return 1.0; }
+    static constexpr bool exerciseBelow = false;
+    static constexpr int homogeneity = 0;
+};
+
+struct DigitalPutPayoff { // Cash-or-nothing : 1 si S < K à maturité
+    static double payoff(double S, double K) { return 1.0 - DigitalCallPayoff::payoff(S, K); }
+    static double averaged(double a, double b, double K) { return 1.0 - DigitalCallPayoff::averaged(a, b, K); }
+    static double lowerCash(double) { return 1.0; }
+    static double upperSpot(double) { return 0.0; }
+    static double upperCash(double) { return 0.0; }
+    static constexpr bool exerciseBelow = true;
+    static constexpr int homogeneity = 0;
+};
+
+// Barrière désactivante à la hausse : l'option s'éteint dès que S atteint la barrière, qui devient la borne Smax de la grille
+// (U = 0 en S = Smax). La grille ne couvre donc que [0, barrière], plus courte que [0, 4K].
+template <class Vanilla>
+struct UpAndOut {
+    static double payoff(double S, double K) { return Vanilla::payoff(S, K); }
+    static double averaged(double a, double b, double K) { return Vanilla::averaged(a, b, K); }
+    static double lowerCash(double K) { return Vanilla::lowerCash(K); }
+    static double upperSpot(double) { return 0.0; }
+    static double upperCash(double) { return 0.0; }
+    static constexpr bool exerciseBelow = Vanilla::exerciseBelow;
+    static constexpr int homogeneity = -1; // Homogène en (S, K, barrière) seulement
+};
 
 class FiniteDifferencePricer {
 public:
@@ -21,188 +509,4897 @@ public:
         double r;     // Taux sans risque (en %)
         double sigma; // Volatilité de l'actif sous-jacent (en %)
         double T;     // Maturité de l'actif (en années)
+        double q = 0.0; // Taux de dividende continu (en %)
     };
 
-    FiniteDifferencePricer(const Parameters& params) // Initialise par défaut les paramètres de calculs des différences finies en utilisant les valeurs initiales de params
-        : params(params), Smax(4.0 * params.K), N(50), M(2000) {}
+    enum class Scheme { Explicit, Implicit, CrankNicolson }; // Schéma de discrétisation temporelle
 
-    void run() {
-        inputParameters(); // Permet à l'utilisateur de renseigner les caractéristiques de l'option
-        int mode = chooseMode(); // Permet à l'utilisateur de choisir le mode de calcul (précision) qu'il souhaite
-        configureMode(mode);
-        if (!checkStability()) { // Au cas où la condition de stabilité n'est pas vérifiée, ce qui ne devrait pas arriver puisque le mode 3 ajuste automatiquement le pas temporel
-            std::cerr << "Erreur : condition de stabilité non respectée.";
-            return;
+    enum class Kernel { Auto, Scalar, AVX2, AVX512, NEON }; // Jeu d'instructions du stencil (Auto : le meilleur disponible sur le processeur)
+
+    // Précision de la remontée en temps. Float : coefficients, prix et substitution en float (deux fois plus de noeuds par vecteur, moitié
+    // moins de trafic mémoire). Mixed : coefficients et factorisations en float, prix et calcul en double. Dans les deux cas les conditions
+    // aux limites sont calculées et conservées en double et la lecture en S0 se fait en double. Exercice européen et coefficients constants
+    // seulement (sinon, et pour les sensibilités, la remontée reste en double).
+    enum class Precision { Double, Float, Mixed };
+
+    enum class Spacing { Uniform, Stretched }; // Répartition des noeuds en S (Stretched : resserrés autour de K et S0 par un changement de variable en sinh)
+
+    enum class Interpolation { Linear, Cubic }; // Lecture du prix et des Grecques en S0 (Cubic : polynôme de degré 3 sur les quatre noeuds encadrant S0)
+
+    enum class Exercise { European, American, Bermudan }; // Exercice à maturité seulement, à tout instant, ou aux dates de GridSettings::exerciseDates
+
+    enum class Payoff { Vanilla, Digital, UpAndOut }; // Call ou put (selon Parameters::type) classique, cash-or-nothing, ou désactivé à la hausse par GridSettings::barrier
+
+    // Courbe constante par intervalle de temps : values[i] s'applique aux dates t de [times[i-1], times[i]) (times[-1] = 0),
+    // la dernière valeur au-delà de la dernière date. Une courbe vide garde la valeur scalaire de Parameters.
+    struct Curve {
+        std::vector<double> times; // Fins des intervalles (en années, croissantes), une par valeur
+        std::vector<double> values;
+
+        bool empty() const { return values.empty(); }
+        int interval(double t) const {
+            const int i = static_cast<int>(std::upper_bound(times.begin(), times.end(), t) - times.begin());
+            return std::min(i, static_cast<int>(values.size()) - 1);
         }
-        computeCallOptionPrice(); // Calcul du prix de l'option call
-        displayResults(); // Affichage du prix de l'option, de Delta et de Gamma
+        double at(double t) const { return values[interval(t)]; }
+        bool operator==(const Curve& o) const { return times == o.times && values == o.values; }
+    };
+
+    // Surface de volatilité locale sigma(S, t) : une ligne de spots par intervalle de temps (mêmes intervalles que Curve),
+    // interpolée linéairement en S et prolongée par la valeur du bord hors de [spots.front(), spots.back()]
+    struct LocalVolatility {
+        std::vector<double> times; // Fins des intervalles, une par ligne
+        std::vector<double> spots; // Croissants
+        std::vector<double> values; // values[i * spots.size() + k] : sigma en spots[k] sur l'intervalle i
+
+        bool empty() const { return values.empty(); }
+        int interval(double t) const {
+            const int i = static_cast<int>(std::upper_bound(times.begin(), times.end(), t) - times.begin());
+            return std::min(i, static_cast<int>(times.size()) - 1);
+        }
+        const double* row(int i) const { return values.data() + static_cast<std::size_t>(i) * spots.size(); }
+        double at(int i, double S) const {
+            const double* v = row(i);
+            const int n = static_cast<int>(spots.size());
+            if (S <= spots[0]) return v[0];
+            if (S >= spots[n - 1]) return v[n - 1];
+            const int k = static_cast<int>(std::upper_bound(spots.begin(), spots.end(), S) - spots.begin()) - 1;
+            const double w = (S - spots[k]) / (spots[k + 1] - spots[k]);
+            return (1.0 - w) * v[k] + w * v[k + 1];
+        }
+        bool sameRow(int i, int j) const { return std::equal(row(i), row(i) + spots.size(), row(j)); }
+        bool operator==(const LocalVolatility& o) const { return times == o.times && spots == o.spots && values == o.values; }
+    };
+
+    // Dividendes en numéraire : amounts[i] détaché à la date times[i] (en années, croissantes), le sous-jacent sautant de S à max(S - D, 0).
+    // Les dates hors de (0, T) sont ignorées.
+    struct CashDividends {
+        std::vector<double> times;
+        std::vector<double> amounts;
+
+        bool empty() const { return amounts.empty(); }
+        bool operator==(const CashDividends& o) const { return times == o.times && amounts == o.amounts; }
+    };
+
+    struct MarketCurves { // r(t), sigma(t) et sigma(S, t) ; la volatilité locale, si elle est fournie, remplace sigma(t)
+        Curve rate;
+        Curve volatility;
+        LocalVolatility localVolatility;
+        CashDividends dividends;
+
+        bool constantCoefficients() const { return rate.empty() && volatility.empty() && localVolatility.empty(); }
+        bool empty() const { return constantCoefficients() && dividends.empty(); }
+        bool operator==(const MarketCurves& o) const {
+            return rate == o.rate && volatility == o.volatility && localVolatility == o.localVolatility && dividends == o.dividends;
+        }
+    };
+
+    struct GridSettings { // Paramètres de discrétisation pour les calculs non interactifs
+        Scheme scheme = Scheme::Explicit;
+        Kernel kernel = Kernel::Auto;
+        Spacing spacing = Spacing::Uniform;
+        Interpolation interpolation = Interpolation::Cubic;
+        int N = 100; // Nombre de pas spatiaux
+        int M = 0;   // Nombre de pas temporels (0 : choix automatique ; le schéma explicite ne le retient que s'il respecte la condition de stabilité)
+        int richardson = 1; // Nombre de grilles emboîtées N, 2N, 4N dont le résultat est extrapolé (1 : pas d'extrapolation, au plus 3)
+        double tolerance = 0.0; // Erreur absolue visée sur le prix : N et M sont choisis par raffinements successifs (0 : grille fixe)
+        bool concurrentLevels = true; // Résout les grilles de l'extrapolation sur des threads séparés (désactivé dans les calculs de portefeuille, déjà parallèles)
+        bool temporalBlocking = true; // Parcours par tuiles espace-temps du schéma explicite pour les grandes grilles (N >= tiledMinN)
+        Precision precision = Precision::Double; // Précision de la remontée en temps (voir Precision)
+        int threads = 1; // Threads d'une même résolution, chacun sur une plage de noeuds (0 : tous les coeurs ; au moins parallelMinChunk noeuds par thread,
+                         // exercice européen et coefficients constants seulement)
+        bool sensitivities = false; // Calcule aussi Vega, Rho, dV/dK et dV/dT (différentiation adjointe du schéma ; exercice européen et coefficients constants seulement)
+        Exercise exercise = Exercise::European;
+        std::vector<double> exerciseDates; // Dates d'exercice anticipé d'une option bermudéenne (en années, 0 <= t < T ; l'exercice à T est toujours possible)
+        Payoff payoff = Payoff::Vanilla;
+        double barrier = 0.0; // Niveau de la barrière (Payoff::UpAndOut), au-dessus de S0 et de K
+        MarketCurves market; // Courbes de taux et de volatilité (vides : r et sigma de Parameters, constants)
+        std::vector<double> snapshotTimes; // Dates (en années, 0 < t < T) des niveaux intermédiaires gardés pour writeSnapshot, au pas de temps le plus proche
+    };
+
+    struct Result { // Prix et Grecques pour S0
+        double price;
+        double delta;
+        double gamma;
+        double theta; // Dérivée du prix par rapport au temps calendaire (par an)
+        // Sensibilités du premier ordre (NaN si elles n'ont pas été demandées)
+        double vega = std::numeric_limits<double>::quiet_NaN();      // dV/dsigma
+        double rho = std::numeric_limits<double>::quiet_NaN();       // dV/dr
+        double dStrike = std::numeric_limits<double>::quiet_NaN();   // dV/dK
+        double dMaturity = std::numeric_limits<double>::quiet_NaN(); // dV/dT
+        double errorEstimate = std::numeric_limits<double>::quiet_NaN(); // Erreur de discrétisation estimée sur le prix (mode tolérance)
+    };
+
+    struct GreeksSurface { // Prix et Grecques en chaque noeud intérieur de la grille (j = 1..N-1)
+        std::vector<double> S;
+        std::vector<double> price;
+        std::vector<double> delta;
+        std::vector<double> gamma;
+        std::vector<double> theta;
+    };
+
+    struct BatchResult { // Résultats d'un portefeuille, rangés par tableaux (un indice par contrat)
+        std::vector<double> price;
+        std::vector<double> delta;
+        std::vector<double> gamma;
+        std::vector<double> theta;
+        std::vector<double> vega;
+        std::vector<double> rho;
+        std::vector<double> dStrike;
+        std::vector<double> dMaturity;
+
+        void assign(std::size_t n, double value) {
+            price.assign(n, value);
+            delta.assign(n, value);
+            gamma.assign(n, value);
+            theta.assign(n, value);
+            vega.assign(n, value);
+            rho.assign(n, value);
+            dStrike.assign(n, value);
+            dMaturity.assign(n, value);
+        }
+        void store(std::size_t i, const Result& r) {
+            price[i] = r.price;
+            delta[i] = r.delta;
+            gamma[i] = r.gamma;
+            theta[i] = r.theta;
+            vega[i] = r.vega;
+            rho[i] = r.rho;
+            dStrike[i] = r.dStrike;
+            dMaturity[i] = r.dMaturity;
+        }
+    };
+
+    enum class Phase { Configure, Coefficients, Backward, Results, Sensitivities, Display, Count }; // Phases mesurées par l'instrumentation
+
+    static const char* phaseName(Phase phase) {
+        static const char* const names[] = {"configure", "coefficients", "backward", "results", "sensitivities", "display"};
+        return names[static_cast<int>(phase)];
     }
 
-private:
-    Parameters params; 
-    double Smax;
-    int N;  // Nombre de pas spatiaux 
-    int M;  // Nombre de pas temporels
-    double dS; // Pas spatial
-    double dt; // Pas temporel
-    std::vector<double> U; // U est le vecteur prix
+#ifdef EDP_INSTRUMENTATION
+    static constexpr bool instrumented = true;
+#else
+    static constexpr bool instrumented = false;
+#endif
+
+    // Compteurs du dernier appel de calcul (price, reprice, priceStrikeLadder ou run), remis à zéro au début de chaque appel.
+    // Ils ne sont remplis que si le programme est compilé avec EDP_INSTRUMENTATION.
+    struct PricingStats {
+        double seconds[static_cast<int>(Phase::Count)] = {}; // Temps exclusif de chaque phase (les phases imbriquées sont retirées), cumulé sur les threads de l'extrapolation
+        long long timeSteps = 0; // Pas de temps parcourus par les résolutions
+        long long nodeUpdates = 0; // Noeuds intérieurs mis à jour (M * (N - 1) par résolution)
+        double stabilityRatio = std::numeric_limits<double>::quiet_NaN(); // dt / (dS^2 / (sigma^2 Smax^2)) de la dernière grille (au plus 1 pour le schéma explicite uniforme)
+        int solves = 0; // Résolutions complètes (les lectures dans une solution déjà calculée n'en sont pas)
+
+        double totalSeconds() const {
+            double total = 0.0;
+            for (double t : seconds) total += t;
+            return total;
+        }
+    };
 
-    static inline double call_payoff(double S, double K) { // Définit la plus-value de l'option à maturité
-        return std::max(S - K, 0.0);
+    const PricingStats& stats() const { return instrumentation.stats; }
+
+    void resetStats() { // Remet les compteurs à zéro et vide la trace
+        instrumentation.stats = PricingStats();
+        instrumentation.events.clear();
     }
 
-    void inputParameters() {
-        std::cout << "Entrez les paramètres de l'option :\n";
-        do {
-        std::cout << "Type d'option (0 pour put, 1 pour call) : ";
-        std::cin >> params.type;
-        if (params.type != 0 && params.type != 1) {
-            std::cerr << "Erreur : Entrez 0 ou 1.\n";
-        }} while (params.type != 0 && params.type != 1);
+    // Écrit les phases mesurées depuis la construction (ou le dernier resetStats) au format Chrome trace (chrome://tracing, Perfetto) :
+    // un événement complet par phase, durées inclusives en microsecondes, tid 0 pour le thread appelant et k pour la k-ième grille de l'extrapolation
+    bool writeTrace(const std::string& path) const {
+        std::ofstream file(path);
+        if (!file) return false;
+        std::string buffer = "{\"traceEvents\":[\n";
+        char number[32];
+        for (std::size_t i = 0; i < instrumentation.events.size(); i++) {
+            const TraceEvent& e = instrumentation.events[i];
+            buffer += "{\"name\":\"";
+            buffer += phaseName(e.phase);
+            buffer += "\",\"ph\":\"X\",\"ts\":";
+            std::snprintf(number, sizeof number, "%.3f", e.start);
+            buffer += number;
+            buffer += ",\"dur\":";
+            std::snprintf(number, sizeof number, "%.3f", e.duration);
+            buffer += number;
+            buffer += ",\"pid\":1,\"tid\":" + std::to_string(e.thread) + "}";
+            buffer += i + 1 < instrumentation.events.size() ? ",\n" : "\n";
+        }
+        buffer += "]}\n";
+        file << buffer;
+        return static_cast<bool>(file);
+    }
 
-        do {
-        std::cout << "Prix de l'actif sous-jacent initial (S0) : ";
-        std::cin >> params.S0;
-        if (params.S0 <= 0) {
-            std::cerr << "Erreur : S0 doit être strictement positif.\n";
-        }} while (params.S0 <= 0);
+    // Instantané de la dernière grille résolue (celle que décrit greeksSurface()), fait pour être projeté en mémoire tel quel par un
+    // autre programme : un en-tête SnapshotHeader puis trois sections de doubles, chacune à un décalage multiple de 64 octets donné par
+    // l'en-tête : les N+1 abscisses S_j, les dates t des niveaux, et les niveaux eux-mêmes, N+1 prix chacun à la suite, du plus proche
+    // (t = 0) au plus lointain (niveaux de GridSettings::snapshotTimes). Ordre des octets de la machine.
+    struct SnapshotHeader {
+        char magic[4]; // "EDPG"
+        std::uint32_t version;
+        std::uint32_t headerSize; // sizeof(SnapshotHeader)
+        std::uint32_t levels; // Nombre de niveaux, t = 0 compris
+        std::int32_t N, M;
+        std::int32_t scheme, spacing, exercise, payoff; // Valeurs des énumérations Scheme, Spacing, Exercise et Payoff
+        std::uint64_t nodesOffset, timesOffset, pricesOffset; // Décalages des sections depuis le début du fichier
+        double dS, Smax, dt, barrier; // dS : pas moyen pour une grille resserrée (les abscisses font foi)
+        Parameters params;
+        std::uint64_t reserved[5];
+    };
+    static_assert(sizeof(SnapshotHeader) == 192, "en-tête d'instantané de 192 octets");
+    static constexpr std::uint32_t snapshotVersion = 1;
 
-        do {
-        std::cout << "Prix Strike (K) : ";
-        std::cin >> params.K;
-        if (params.K <= 0) {
-            std::cerr << "Erreur : K doit être strictement positif.\n";
-        }} while (params.K <= 0);
+    bool writeSnapshot(const std::string& path) const {
+        const std::size_t n = static_cast<std::size_t>(N) + 1;
+        const std::size_t levels = 1 + keptLevel.size();
+        if (U.size() < n || nodes.size() < n) return false; // Aucune grille résolue
+        auto aligned = [](std::size_t offset) { return (offset + 63) / 64 * 64; };
+        SnapshotHeader h{};
+        std::memcpy(h.magic, "EDPG", 4);
+        h.version = snapshotVersion;
+        h.headerSize = sizeof(SnapshotHeader);
+        h.levels = static_cast<std::uint32_t>(levels);
+        h.N = N;
+        h.M = M;
+        h.scheme = static_cast<std::int32_t>(scheme);
+        h.spacing = static_cast<std::int32_t>(spacing);
+        h.exercise = static_cast<std::int32_t>(exercise);
+        h.payoff = static_cast<std::int32_t>(payoff);
+        h.nodesOffset = aligned(sizeof(h));
+        h.timesOffset = aligned(h.nodesOffset + n * sizeof(double));
+        h.pricesOffset = aligned(h.timesOffset + levels * sizeof(double));
+        h.dS = dS;
+        h.Smax = Smax;
+        h.dt = dt;
+        h.barrier = barrier;
+        h.params = params;
+        const std::size_t size = h.pricesOffset + levels * n * sizeof(double);
 
-        do {
-        std::cout << "Taux sans risque (r) : ";
-        std::cin >> params.r;
-        if (params.r < 0 || params.r > 1) {
-            std::cerr << "Erreur : r doit être entre 0 et 1. Exemple : 5% = 0.05.\n";
-        }} while (params.r < 0 || params.r > 1);
-        
-        do {
-        std::cout << "Volatilité (sigma) : ";
-        std::cin >> params.sigma;
-        if (params.sigma <= 0 || params.sigma > 1) {
-            std::cerr << "Erreur : sigma doit être strictement positif et inférieur à 1.\n";
-        }} while (params.sigma <= 0 || params.sigma > 1);
-        
-        do {
-        std::cout << "Maturité (T) : ";
-        std::cin >> params.T;
-        if (params.T <= 0) {
-            std::cerr << "Erreur : T doit être strictement positif.\n";
-        }} while (params.T <= 0);
-        Smax = 4.0 * params.K;
+        auto fill = [&](char* out) { // Les niveaux gardés l'ont été du plus lointain au plus proche
+            std::memcpy(out, &h, sizeof(h));
+            std::memcpy(out + h.nodesOffset, nodes.data(), n * sizeof(double));
+            double* times = reinterpret_cast<double*>(out + h.timesOffset);
+            double* prices = reinterpret_cast<double*>(out + h.pricesOffset);
+            times[0] = 0.0;
+            std::copy(U.begin(), U.begin() + static_cast<std::ptrdiff_t>(n), prices);
+            for (std::size_t k = 1; k < levels; k++) {
+                const std::size_t i = levels - 1 - k;
+                times[k] = keptLevel[i] * dt;
+                std::copy(keptPrices.begin() + static_cast<std::ptrdiff_t>(i * n), keptPrices.begin() + static_cast<std::ptrdiff_t>((i + 1) * n), prices + k * n);
+            }
+        };
+#ifdef EDP_MMAP
+        // Écriture directe dans la projection du fichier : pas de copie intermédiaire des niveaux
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        bool ok = ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+        void* p = ok ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        if (p != MAP_FAILED) {
+            fill(static_cast<char*>(p));
+            ok = ::munmap(p, size) == 0;
+        } else {
+            ok = false;
+        }
+        return ::close(fd) == 0 && ok;
+#else
+        std::vector<char> buffer(size, 0);
+        fill(buffer.data());
+        std::ofstream file(path, std::ios::binary);
+        file.write(buffer.data(), static_cast<std::streamsize>(size));
+        return static_cast<bool>(file);
+#endif
     }
 
-    int chooseMode() {
-        std::cout << "Choisissez un mode :\n";
-        std::cout << "1. Précis (petits pas, mais exécution lente)\n";
-        std::cout << "2. Rapide (grands pas, mais moins précis)\n";
-        std::cout << "3. Personnalisé (nombre de pas spatial à choisir) \n";
-        int mode;
-        std::cin >> mode;
-        return mode;
+    FiniteDifferencePricer(const Parameters& params) // Initialise par défaut les paramètres de calculs des différences finies en utilisant les valeurs initiales de params
+        : params(params), Smax(4.0 * params.K), N(50), M(2000), scheme(Scheme::Explicit) {
+        selectKernel(Kernel::Auto);
     }
 
-    void configureMode(int mode) {
-        switch (mode) {
-        case 1: // Précis
-            N = 2000;
-            break;
-        case 2: // Rapide
-            N = 100;
-            break;
-        case 3: // Personnalisé
-            std::cout << "Entrez le nombre de pas spatiaux (N) : ";
-            std::cin >> N;
-            break;
+    // Choisit le noyau du stencil ; un jeu d'instructions non supporté par le processeur retombe sur le choix automatique
+    void selectKernel(Kernel requested) {
+        if (!kernelSupported(requested)) requested = Kernel::Auto;
+        if (requested == Kernel::Auto) {
+            requested = kernelSupported(Kernel::AVX512) ? Kernel::AVX512
+                      : kernelSupported(Kernel::AVX2) ? Kernel::AVX2
+                      : kernelSupported(Kernel::NEON) ? Kernel::NEON
+                      : Kernel::Scalar;
+        }
+        kernel = requested;
+        switch (kernel) {
+#ifdef EDP_X86_KERNELS
+        case Kernel::AVX512: stencil = stencilAvx512; adjointKernel = adjointAvx512; floatIncrement = incrementFloatAvx512; mixedIncrement = incrementMixedAvx512; break;
+        case Kernel::AVX2: stencil = stencilAvx2; adjointKernel = adjointAvx2; floatIncrement = incrementFloatAvx2; mixedIncrement = incrementMixedAvx2; break;
+#endif
+#ifdef EDP_NEON_KERNELS
+        case Kernel::NEON: stencil = stencilNeon; adjointKernel = adjointNeon; floatIncrement = incrementFloatNeon; mixedIncrement = incrementMixedNeon; break;
+#endif
         default:
-            std::cerr << "Mode invalide, utilisation du mode Rapide par défaut.\n";
-            N = 100;
-            break;;
+            stencil = stencilScalar;
+            adjointKernel = adjointScalar;
+            floatIncrement = incrementScalar<float>;
+            mixedIncrement = incrementScalar<double>;
+            break;
         }
+    }
 
-        // Définir des bornes dynamiques pour dt et M
-        // Nécessaire dans des cas extrêmes où la volatilité est très faible et où la saturation de la condition de stabilité mène à des valeurs très petites pour M.
-        const int M_target = 100;  // Minimum pour le nombre de pas temporels
-        double dt_max = params.T / M_target;
-        
-        dS = Smax / N; 
-        dt = std::min((dS * dS) / (params.sigma * params.sigma * Smax * Smax),dt_max); // Sature la condition de stabilité
-        M = static_cast<int>(params.T / dt) + 1;
-        std::cout << "Pas temporel calculé (dt) : " << dt << ", Nombre de pas temporels (M) : " << M << "\n";
+    Kernel selectedKernel() const { return kernel; }
+    int timeSteps() const { return M; } // Nombre de pas temporels de la dernière grille résolue (choix automatique compris)
+    void discardSolution() { solution.valid = false; } // Le prochain price() refait la résolution au lieu de relire la solution (mesures de performance)
+
+    // Dimensionne une fois pour toutes les buffers de la grille pour N <= maxN (et, si maxM > 0, ceux de la passe adjointe pour M <= maxM) :
+    // les appels suivants à price() sur ce pricer, même contrat ou nouveau marché, ne font plus aucune allocation.
+    // Sans appel à reserve(), les buffers grandissent au premier calcul de chaque taille puis sont réutilisés de la même façon.
+    // L'extrapolation de Richardson alloue encore ses pricers de grilles grossières (au premier appel) et, si grid.concurrentLevels, ses threads.
+    // Une résolution sur plusieurs threads (grid.threads > 1) crée aussi ses threads à chaque appel ; ses buffers par thread grandissent au
+    // premier appel de chaque taille, comme les autres.
+    void reserve(int maxN, int maxM = 0) {
+        const std::size_t n = static_cast<std::size_t>(maxN) + 1;
+        for (AlignedVector* v : {&U, &U_old, &coef.a, &coef.b, &coef.c}) v->reserve(n);
+        nodes.reserve(n);
+        solver.reserve(n);
+        startSolver.reserve(n);
+        intrinsic.reserve(n);
+        nodeSigma.reserve(n);
+        jumped.reserve(n);
+        for (AlignedFloatVector* v : {&single.a, &single.c, &single.e, &single.U, &single.U_old}) v->reserve(n);
+        single.solver.reserve(n);
+        single.startSolver.reserve(n);
+        if (maxM <= 0) return;
+        levelDiscount.reserve(static_cast<std::size_t>(maxM) + 1);
+        dividendValue.reserve(static_cast<std::size_t>(maxM) + 1);
+        for (std::vector<double>* v : {&lambda, &lambdaNext, &rhsBar, &sigmaLo, &sigmaHi, &rateLo, &rateHi}) v->reserve(n);
+        adjointA.reserve(n);
+        adjointC.reserve(n);
+        adjointSolver.reserve(n);
+        adjointStartSolver.reserve(n);
+        // Pire cas sur M <= maxM : grille entière sous tapeBudget, ou segments d'au plus ceil(sqrt(maxM)) niveaux
+        const std::size_t segmentLevels = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(maxM))));
+        tape.reserve(std::max(std::min(static_cast<std::size_t>(maxM) * n, tapeBudget), segmentLevels * n));
+        segment.reserve(segmentLevels * n);
+        levels.reserve(segmentLevels + 1);
     }
 
-    bool checkStability() const { // Vérifie si la condition de stabilité du modèle est bien respectée (devrait toujours l'être car dans les 3 modes le pas de temps est choisi afin de respecter cette contrainte)
-        return dt <= dS * dS / (params.sigma * params.sigma * Smax * Smax);
+    static bool kernelSupported(Kernel k) { // Détection à l'exécution des jeux d'instructions
+        switch (k) {
+        case Kernel::Auto:
+        case Kernel::Scalar:
+            return true;
+#ifdef EDP_X86_KERNELS
+        case Kernel::AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case Kernel::AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f");
+#endif
+#ifdef EDP_NEON_KERNELS
+        case Kernel::NEON:
+            return true; // NEON fait partie de l'architecture AArch64
+#endif
+        default:
+            return false;
+        }
     }
 
-    void computeCallOptionPrice() {
-        U.assign(N + 1, 0.0); // Initialisation du vecteur prix 
-        std::vector<double> U_old(N + 1, 0.0); // Création d'un deuxième vecteur qui gardera en mémoire les prix à la temporalité t+dt
-        // Nous faisons le choix d'opter pour deux vecteurs. Nous aurions pu créer une matrice qui garderait l'historique des prix.
-        // Ce choix rend l'implémentation plus légère, mais ne permet pas de conserver l'historique des prix complets.
-        for (int j = 0; j <= N; j++) {
-            U[j] = call_payoff(j * dS, params.K); // Conditions limites (à maturité) : le prix de l'option est donc la plus value
+    static const char* kernelName(Kernel k) {
+        switch (k) {
+        case Kernel::Scalar: return "scalar";
+        case Kernel::AVX2: return "avx2";
+        case Kernel::AVX512: return "avx512";
+        case Kernel::NEON: return "neon";
+        default: return "auto";
         }
+    }
 
-        for (int m = M; m > 0; m--) {
-            U_old = U;  // Copie du U actuel (qui deviendra l'ancien à l'étape d'après)
-            for (int j = 1; j < N; j++) { // On définit les variables a, b et c qui interviennent dans la formule de récurrence
-                double S = j * dS;
-                double alpha = (params.sigma * params.sigma * S * S * dt) / (2.0 * dS * dS);
-                double beta = (params.r * S * dt) / (2.0 * dS);
-                double a = alpha - beta;
-                double b = 1.0 - params.r * dt - 2.0 * alpha;
-                double c = alpha + beta;
-                U[j] = a * U_old[j - 1] + b * U_old[j] + c * U_old[j + 1];  // Calcul du nouveau vecteur prix U par la formule de récurrence
-            }
+    static const char* precisionName(Precision p) {
+        switch (p) {
+        case Precision::Float: return "float";
+        case Precision::Mixed: return "mixed";
+        default: return "double";
+        }
+    }
 
-            // Conditions aux limites (t=0)
-            U[0] = 0.0; // j=0 : S=0, pour un call : U=0
+    void run() {
+        EDP_PRICING_CALL();
+        inputParameters(); // Permet à l'utilisateur de renseigner les caractéristiques de l'option
+        configureMarket(MarketCurves()); // Taux et volatilité constants en mode interactif
+        configureExercise(chooseExercise(), exerciseDates); // Européen ou américain
+        snapshotTimes.clear();
+        scheme = chooseScheme(); // Permet à l'utilisateur de choisir le schéma temporel
+        int mode = chooseMode(); // Permet à l'utilisateur de choisir le mode de calcul (précision) qu'il souhaite
+        configureMode(mode);
+        if (richardsonLevels > 1 || tolerance > 0) { // Modes Extrapolé et Tolérance : plusieurs grilles sont résolues puis combinées
+            GridSettings grid;
+            grid.scheme = scheme;
+            grid.exercise = exercise;
+            grid.N = N;
+            grid.richardson = richardsonLevels;
+            grid.tolerance = tolerance;
+            const Result res = price(params, grid);
+            EDP_PHASE(Display);
+            displayResults(res);
+            return;
+        }
+        if (!checkStability()) { // Au cas où la condition de stabilité n'est pas vérifiée, ce qui ne devrait pas arriver puisque le mode 3 ajuste automatiquement le pas temporel
+            std::cerr << "Erreur : condition de stabilité non respectée.";
+            return;
+        }
+        computeOptionPrice(); // Calcul du prix de l'option
+        displayResults(); // Affichage du prix de l'option, de Delta et de Gamma
+    }
 
-            // t=0, j=N : S=Smax, condition limite : U(Smax,t)
-            double tau = params.T - (m - 1) * dt; // Temps futur par rapport à la finalité
-            U[N] = Smax - params.K * std::exp(-params.r * tau);
+    // Règles de validation des paramètres, communes à la saisie interactive et aux modes non interactifs.
+    // Chaque fonction renvoie le message d'erreur, ou nullptr si la valeur est acceptée.
+    static const char* typeError(double type) {
+        return (type != 0 && type != 1) ? "Erreur : Entrez 0 ou 1." : nullptr;
+    }
+    static const char* spotError(double S0) {
+        return S0 <= 0 ? "Erreur : S0 doit être strictement positif." : nullptr;
+    }
+    static const char* strikeError(double K) {
+        return K <= 0 ? "Erreur : K doit être strictement positif." : nullptr;
+    }
+    static const char* rateError(double r) {
+        return (r < 0 || r > 1) ? "Erreur : r doit être entre 0 et 1. Exemple : 5% = 0.05." : nullptr;
+    }
+    static const char* dividendYieldError(double q) {
+        return (q < 0 || q > 1) ? "Erreur : q doit être entre 0 et 1. Exemple : 2% = 0.02." : nullptr;
+    }
+    static const char* volatilityError(double sigma) {
+        return (sigma <= 0 || sigma > 1) ? "Erreur : sigma doit être strictement positif et inférieur à 1." : nullptr;
+    }
+    static const char* maturityError(double T) {
+        return T <= 0 ? "Erreur : T doit être strictement positif." : nullptr;
+    }
+    static const char* parameterError(const Parameters& p) { // Première règle violée par le contrat, ou nullptr
+        if (const char* e = typeError(p.type)) return e;
+        if (const char* e = spotError(p.S0)) return e;
+        if (const char* e = strikeError(p.K)) return e;
+        if (const char* e = rateError(p.r)) return e;
+        if (const char* e = volatilityError(p.sigma)) return e;
+        if (const char* e = dividendYieldError(p.q)) return e;
+        return maturityError(p.T);
+    }
+    static const char* marketError(const MarketCurves& m) { // Courbes cohérentes, valeurs soumises aux mêmes règles que r et sigma
+        auto increasing = [](const std::vector<double>& x) {
+            for (std::size_t i = 0; i < x.size(); i++) if (!(x[i] > (i ? x[i - 1] : 0.0))) return false;
+            return true;
+        };
+        if (m.rate.times.size() != m.rate.values.size() || !increasing(m.rate.times)) return "Erreur : courbe de taux mal formée (dates croissantes, une par valeur).";
+        for (double r : m.rate.values) if (const char* e = rateError(r)) return e;
+        if (m.volatility.times.size() != m.volatility.values.size() || !increasing(m.volatility.times)) return "Erreur : courbe de volatilité mal formée (dates croissantes, une par valeur).";
+        for (double v : m.volatility.values) if (const char* e = volatilityError(v)) return e;
+        const LocalVolatility& lv = m.localVolatility;
+        if (!lv.empty() && (lv.spots.empty() || lv.values.size() != lv.times.size() * lv.spots.size() || !increasing(lv.times) || !increasing(lv.spots))) {
+            return "Erreur : surface de volatilité locale mal formée (dates et spots croissants, une ligne par date).";
         }
+        for (double v : lv.values) if (const char* e = volatilityError(v)) return e;
+        const CashDividends& d = m.dividends;
+        if (d.times.size() != d.amounts.size() || !increasing(d.times)) return "Erreur : dividendes mal formés (dates croissantes, un montant par date).";
+        for (double D : d.amounts) if (!(D >= 0 && D < std::numeric_limits<double>::infinity())) return "Erreur : les dividendes doivent être positifs.";
+        return nullptr;
+    }
+    static const char* barrierError(const Parameters& p, const GridSettings& g) { // La barrière borne la grille : elle doit dépasser S0 et K
+        if (g.payoff != Payoff::UpAndOut || (g.barrier > p.S0 && g.barrier > p.K)) return nullptr;
+        return "Erreur : la barrière doit être supérieure à S0 et à K.";
     }
 
-    // À présent, U correspond à la grille au temps t=0.
-    // On récupère le prix pour S0. On doit interpoler si S0 n'est pas un point de grille exact.
+    // Calcul non interactif d'un contrat : les buffers de la grille sont réutilisés d'un appel à l'autre.
+    // Un contrat invalide (mêmes règles que la saisie) donne des résultats NaN.
+    Result price(const Parameters& p, const GridSettings& grid) {
+        EDP_PRICING_CALL();
+        lastGrid = grid;
+        if (grid.tolerance > 0.0) return priceToTolerance(p, grid);
+        if (grid.richardson > 1) return priceRichardson(p, grid);
+        return solve(p, grid, contractSmax(p, grid), false);
+    }
 
-    void displayResults() {
-        double S0_index = params.S0 / dS;
-        int j0 = static_cast<int>(std::floor(S0_index));
-        double w = S0_index - j0; 
-        
-        double price_call = (j0 >= 0 && j0 < N) ? (1.0 - w) * U[j0] + w * U[j0 + 1] : U[j0]; // Il s'agit du prix du call
+    // Nouveau spot pour le dernier contrat calculé, avec les mêmes réglages : tant que le marché (K, r, sigma, T) et la grille ne changent pas,
+    // le prix et les Grecques se lisent dans la solution à t=0 déjà calculée (interpolation en S0, sans résolution).
+    // L'extrapolation et le mode tolérance placent S0 sur un noeud (Smax en dépend) : ils refont leurs résolutions à chaque spot.
+    Result reprice(double S0) {
+        Parameters p = params;
+        p.S0 = S0;
+        return price(p, lastGrid);
+    }
 
-        // Calcul des Grecques (Delta et Gamma) pour le call par différences finies.
-        // On utilise les points j0-1, j0, j0+1, en vérifiant que j0>0 et j0<N :
+    // Extrapolation de Richardson : le contrat est résolu sur grid.richardson grilles emboîtées (N, 2N, 4N ; pas de temps divisé par 2
+    // pour les schémas theta et par 4 pour le schéma explicite), les grilles grossières sur des threads séparés, la plus fine sur le
+    // thread appelant (greeksSurface() la décrit ensuite). Les termes d'erreur en h^2 puis h^4 sont éliminés (h puis h^2 pour le schéma
+    // implicite, d'ordre 1 en temps, et pour Theta, différence finie d'ordre 1 en temps).
+    // L'erreur de chaque grille ne se développe régulièrement en puissances de h que si S0 est un noeud (Smax est ajusté de moins d'un pas)
+    // et si le payoff est moyenné sur chaque maille (K ne tombe en général pas sur un noeud).
+    Result priceRichardson(const Parameters& p, const GridSettings& grid) {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        if (!validParameters(p) || grid.N < 2 || barrierError(p, grid) || marketError(grid.market)) return {nan, nan, nan, nan};
+        const int levels = std::min(grid.richardson, maxRichardsonLevels);
+        params = p;
+        scheme = grid.scheme;
+        spacing = grid.spacing;
+        payoff = grid.payoff;
+        barrier = grid.barrier;
+        configureMarket(grid.market); // Le pas explicite de la grille grossière dépend des courbes
+        N = grid.N;
+        const double smax = Smax = alignedSmax();
+        configureGrid(grid.M); // Pas de temps de la grille la plus grossière
+        const int baseM = M;
+        const int timeRefinement = scheme == Scheme::Explicit ? 4 : 2; // dt suit dS^2 pour le schéma explicite, dS pour les schémas theta
 
-        double Delta_call = (j0 > 0 && j0 < N) ? (U[j0 + 1] - U[j0 - 1]) / (2.0 * dS) : 0.0;
-        double Gamma = (j0 > 0 && j0 < N) ? (U[j0 + 1] - 2.0 * U[j0] + U[j0 - 1]) / (dS * dS) : 0.0; // Gamma est le même pour call et put
-      
-        double price = price_call;
+        Result r[maxRichardsonLevels];
+        auto solveLevel = [&](FiniteDifferencePricer* pricer, int k) {
+            GridSettings level = grid;
+            level.richardson = 1;
+            level.interpolation = Interpolation::Linear; // S0 est un noeud : Delta et Gamma y sont lus par les différences centrées, dont l'erreur est en h^2, h^4...
+            level.N = grid.N << k;
+            level.M = baseM;
+            for (int i = 0; i < k; i++) level.M *= timeRefinement;
+            r[k] = pricer->solve(p, level, smax, true);
+        };
+        levelPricers.resize(levels - 1);
+        std::vector<std::thread> threads;
+        for (int k = 0; k < levels - 1; k++) {
+            if (!levelPricers[k]) levelPricers[k].reset(new FiniteDifferencePricer(p));
+            levelPricers[k]->resetStats();
+            if (grid.concurrentLevels) threads.emplace_back(solveLevel, levelPricers[k].get(), k);
+            else solveLevel(levelPricers[k].get(), k);
+        }
+        solveLevel(this, levels - 1);
+        for (std::thread& t : threads) t.join();
+#ifdef EDP_INSTRUMENTATION
+        for (int k = 0; k < levels - 1; k++) mergeStats(*levelPricers[k], k + 1);
+#endif
 
-        double Delta = Delta_call;
-        
-        if (params.type==0) {
-        price = price_call - params.S0 + params.K * std::exp(-params.r * params.T); // parité put-call
-        Delta = Delta_call - 1;
+        const int order = scheme == Scheme::Implicit ? 1 : 2; // Ordre de la grille en h (dt proportionnel à h)
+        const int thetaOrder = scheme == Scheme::Explicit ? 2 : 1;
+        double Result::* const fields[] = {&Result::price, &Result::delta, &Result::gamma, &Result::vega, &Result::rho, &Result::dStrike};
+        Result res = r[levels - 1];
+        for (double Result::* f : fields) {
+            const double v[] = {r[0].*f, r[1].*f, levels > 2 ? r[2].*f : 0.0};
+            res.*f = extrapolate(v, levels, order, 2 * order);
         }
+        for (double Result::* f : {&Result::theta, &Result::dMaturity}) {
+            const double v[] = {r[0].*f, r[1].*f, levels > 2 ? r[2].*f : 0.0};
+            res.*f = extrapolate(v, levels, thetaOrder, 2 * thetaOrder);
+        }
+        return res;
+    }
 
+    // Choix de la grille par raffinements successifs pour une erreur absolue grid.tolerance sur le prix.
+    // Partant de (N, M) = (adaptiveStartN, M automatique), chaque itération résout aussi (2N, M) et (N, 2M) : les écarts donnent
+    // séparément l'erreur spatiale (ordre 2) et l'erreur temporelle (ordre 1 implicite, 2 Crank-Nicolson) de la grille (N, M).
+    // Si l'une des trois grilles est dans la tolérance elle est renvoyée, sinon N et M sautent directement aux tailles prédites
+    // pour que la grille raffinée en espace de l'itération suivante soit dans la tolérance. Un contrat facile s'arrête après une itération sur de petites grilles.
+    // Le schéma explicite n'a pas de M libre (dt suit la condition de stabilité, erreur en dt comprise dans celle en dS^2) : seul N est raffiné.
+    // S0 est placé sur un noeud et le payoff moyenné, comme pour l'extrapolation, pour que l'erreur décroisse régulièrement.
+    // L'estimation ne couvre que la discrétisation : la troncature du domaine à Smax = 4K ne diminue pas avec N et M.
+    Result priceToTolerance(const Parameters& p, const GridSettings& grid) {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        if (!validParameters(p) || barrierError(p, grid) || marketError(grid.market)) return {nan, nan, nan, nan};
+        params = p;
+        scheme = grid.scheme;
+        spacing = grid.spacing;
+        payoff = grid.payoff;
+        barrier = grid.barrier;
+        configureMarket(grid.market);
+        N = adaptiveStartN;
+        const double smax = Smax = alignedSmax();
+        configureGrid(0);
+        const int baseM = M;
+        const bool explicitScheme = scheme == Scheme::Explicit;
+        const int timeOrder = scheme == Scheme::Implicit ? 1 : 2;
+        const int maxN = explicitScheme ? adaptiveMaxExplicitN : adaptiveMaxN; // Le coût explicite croît comme N^3
 
-        std::cout << "Prix de l'option : " << price << "\n";
-        std::cout << "Delta : " << Delta << "\n";
-        std::cout << "Gamma : " << Gamma << "\n";
+        GridSettings level = grid;
+        level.richardson = 1;
+        level.tolerance = 0.0;
+        level.interpolation = Interpolation::Linear; // S0 est un noeud, comme pour l'extrapolation
+        auto solveAt = [&](int n, int m) {
+            level.N = n;
+            if (explicitScheme) { // Pas de temps proportionnel à dS^2, au niveau de la condition de stabilité
+                const double ratio = static_cast<double>(n) / adaptiveStartN;
+                m = static_cast<int>(std::ceil(baseM * ratio * ratio));
+            }
+            level.M = m;
+            return solve(p, level, smax, true);
+        };
+        auto roundN = [&](double n) { // Multiple de la première grille (S0 reste un noeud), borné par maxN
+            const int steps = static_cast<int>(std::ceil(n / adaptiveStartN));
+            return std::min(maxN, std::max(1, steps) * adaptiveStartN);
+        };
+
+        int n = adaptiveStartN, m = baseM;
+        for (;;) {
+            Result base = solveAt(n, m);
+            Result finerS = solveAt(2 * n, m);
+            const double errS = std::abs(finerS.price - base.price) * 4.0 / 3.0; // Erreur spatiale de (N, M) : e(N) - e(2N) = (3/4) e(N)
+            double errT = 0.0;
+            Result finerT = base;
+            if (!explicitScheme) {
+                const double f = 1 << timeOrder;
+                finerT = solveAt(n, 2 * m);
+                errT = std::abs(finerT.price - base.price) * f / (f - 1.0);
+            }
+            base.errorEstimate = errS + errT;
+            finerS.errorEstimate = errS / 4.0 + errT;
+            finerT.errorEstimate = errS + errT / (1 << timeOrder);
+            Result best = finerS.errorEstimate < base.errorEstimate ? finerS : base;
+            if (!explicitScheme && finerT.errorEstimate < best.errorEstimate) best = finerT;
+            if (!(best.errorEstimate > grid.tolerance)) return best; // NaN : contrat hors grille, inutile d'insister
+
+            // Tailles prédites (avec 20 % de marge) pour que la grille (2N, M) de l'itération suivante ait des erreurs spatiale et
+            // temporelle de grid.tolerance / 2 chacune : c'est elle qui sera renvoyée, la grille (N, M) ne sert qu'à l'estimation
+            const int nextN = errS > 2.0 * grid.tolerance ? roundN(1.2 * n * std::sqrt(0.5 * errS / grid.tolerance)) : n;
+            const int nextM = errT > 0.5 * grid.tolerance
+                ? std::min(adaptiveMaxM, static_cast<int>(std::ceil(1.2 * m * std::pow(2.0 * errT / grid.tolerance, 1.0 / timeOrder)))) : m;
+            if (nextN == n && nextM == m) return best; // Grilles maximales atteintes
+            n = nextN;
+            m = nextM;
+        }
     }
-};
 
-int main() {
+    // Échelle de strikes de même (type, S0, r, sigma, T) : le modèle de Black-Scholes est homogène en (S, K), soit C(S, K) = K * C(S/K, 1).
+    // On résout donc une seule fois sur la grille normalisée (K = 1, Smax = 4) et on lit chaque strike dans cette solution.
+    // La grille normalisée correspond exactement à celle de chaque strike (Smax = 4K, dS = 4K/N, même dt) : les prix sont identiques à des calculs séparés.
+    // Une grille resserrée est centrée sur le strike normalisé (S0 = K = 1) et sert à toute l'échelle.
+    // Des courbes r(t) et sigma(t) et un taux de dividende q préservent l'homogénéité ; les options digitales (homogènes de degré 0),
+    // à barrière (borne fixe), la volatilité locale (sigma donnée en S absolu) et les dividendes en numéraire sont calculés strike par strike.
+    // L'extrapolation, le mode tolérance (S0 sur un noeud, grilles propres à chaque strike), les sensibilités et les niveaux gardés pour
+    // writeSnapshot passent aussi par price() strike par strike : la lecture dans la grille normalisée ne les fournirait pas.
+    BatchResult priceStrikeLadder(const Parameters& base, const std::vector<double>& strikes, const GridSettings& grid) {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        const std::size_t n = strikes.size();
+        EDP_PRICING_CALL();
+        BatchResult res;
+        res.assign(n, nan);
+        if (grid.payoff != Payoff::Vanilla || !grid.market.localVolatility.empty() || !grid.market.dividends.empty()
+            || grid.richardson > 1 || grid.tolerance > 0.0 || grid.sensitivities || !grid.snapshotTimes.empty()) {
+            for (std::size_t i = 0; i < n; i++) {
+                Parameters p = base;
+                p.K = strikes[i];
+                res.store(i, price(p, grid));
+            }
+            return res;
+        }
+
+        Parameters unit = base;
+        unit.K = 1.0;
+        unit.S0 = 1.0;
+        if (!validParameters(unit) || grid.N < 2 || marketError(grid.market)) return res;
+        params = unit;
+        Smax = 4.0;
+        scheme = grid.scheme;
+        spacing = grid.spacing;
+        if (grid.kernel != kernel) selectKernel(grid.kernel);
+        temporalBlocking = grid.temporalBlocking;
+        precision = grid.precision;
+        sweepThreads = grid.threads > 0 ? grid.threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        smoothPayoff = false;
+        interpolation = grid.interpolation;
+        configureExercise(grid.exercise, grid.exerciseDates);
+        configureMarket(grid.market);
+        snapshotTimes.clear();
+        payoff = Payoff::Vanilla;
+        N = grid.N;
+        configureGrid(grid.M);
+        if (!checkStability()) return res;
+        computeOptionPrice();
+
+        for (std::size_t i = 0; i < n; i++) {
+            Parameters p = base;
+            p.K = strikes[i];
+            if (!validParameters(p)) continue;
+            res.store(i, resultsAt(p.S0, p.K));
+        }
+        return res;
+    }
+
+    // Prix et Grecques de la dernière grille calculée, en chaque noeud intérieur, en un seul passage sans branchement (vectorisable).
+    // Remplace les recalculs avec S0 décalé : toute une échelle de scénarios de spot sort d'une seule résolution.
+    GreeksSurface greeksSurface() const {
+        GreeksSurface g;
+        const int n = N - 1;
+        g.S.resize(n);
+        g.price.resize(n);
+        g.delta.resize(n);
+        g.gamma.resize(n);
+        g.theta.resize(n);
+        const double* u = U.data();
+        const double* v = U_old.data();
+        const double* x = nodes.data();
+        const double invdt = 1.0 / dt;
+        for (int j = 1; j < N; j++) { // Dérivées à trois points sur une grille quelconque (différences centrées si elle est uniforme)
+            const double S = x[j];
+            const double hm = S - x[j - 1], hp = x[j + 1] - S;
+            const double dm = (u[j] - u[j - 1]) / hm, dp = (u[j + 1] - u[j]) / hp;
+            g.S[j - 1] = S;
+            g.price[j - 1] = u[j];
+            g.delta[j - 1] = (hp * dm + hm * dp) / (hm + hp);
+            g.gamma[j - 1] = 2.0 * (dp - dm) / (hm + hp);
+            g.theta[j - 1] = (v[j] - u[j]) * invdt;
+        }
+        return g;
+    }
+
+    // Calcule tout un portefeuille en une fois, réparti sur nThreads threads (0 : tous les coeurs).
+    // Chaque thread possède son propre pricer et une plage de contrats ; un thread qui a fini sa plage vole les contrats restants des autres.
+    static BatchResult priceBatch(const std::vector<Parameters>& book, const GridSettings& grid, unsigned nThreads = 0) {
+        const std::size_t n = book.size();
+        BatchResult res;
+        res.assign(n, 0.0);
+        if (n == 0) return res;
+
+        if (nThreads == 0) nThreads = std::max(1u, std::thread::hardware_concurrency());
+        nThreads = static_cast<unsigned>(std::min<std::size_t>(nThreads, n));
+
+        struct alignas(64) Range { // Aligné sur une ligne de cache pour éviter le faux partage entre threads
+            std::atomic<std::size_t> next;
+            std::size_t end;
+        };
+        std::vector<Range> ranges(nThreads);
+        for (unsigned t = 0; t < nThreads; t++) {
+            ranges[t].next.store(n * t / nThreads, std::memory_order_relaxed);
+            ranges[t].end = n * (t + 1) / nThreads;
+        }
+
+        GridSettings contractGrid = grid;
+        contractGrid.concurrentLevels = false; // Les contrats sont déjà répartis sur les threads
+        contractGrid.threads = 1;
+        auto worker = [&](unsigned self) {
+            FiniteDifferencePricer pricer(book[0]);
+            for (unsigned k = 0; k < nThreads; k++) { // D'abord sa propre plage, puis celles des autres threads
+                Range& range = ranges[(self + k) % nThreads];
+                for (std::size_t i = range.next.fetch_add(1, std::memory_order_relaxed); i < range.end;
+                     i = range.next.fetch_add(1, std::memory_order_relaxed)) {
+                    res.store(i, pricer.price(book[i], contractGrid));
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < nThreads; t++) threads.emplace_back(worker, t);
+        worker(0);
+        for (std::thread& th : threads) th.join();
+        return res;
+    }
+
+private:
+    Parameters params; 
+    double Smax;
+    int N;  // Nombre de pas spatiaux 
+    int M;  // Nombre de pas temporels
+    double dS; // Pas spatial (pas moyen pour une grille resserrée)
+    double dt; // Pas temporel
+    Scheme scheme;
+    Spacing spacing = Spacing::Uniform;
+    Interpolation interpolation = Interpolation::Cubic;
+    Exercise exercise = Exercise::European;
+    bool earlyExercise = false; // Projection sur la valeur d'exercice aux niveaux marqués dans exerciseLevel
+    Payoff payoff = Payoff::Vanilla;
+    double barrier = 0.0;
+    std::vector<double> exerciseDates; // Dates d'exercice de l'option bermudéenne en cours
+    std::vector<unsigned char> exerciseLevel; // exerciseLevel[m] : exercice possible au temps m*dt
+    AlignedVector intrinsic; // Valeur d'exercice en chaque noeud, plancher de la projection
+    std::vector<double> snapshotTimes; // Dates des niveaux intermédiaires gardés par la dernière remontée (writeSnapshot)
+    std::vector<int> keptLevel; // Niveaux correspondants, dans l'ordre de la remontée (du plus tardif au plus proche)
+    std::vector<double> keptPrices; // N+1 prix par niveau gardé, dans l'ordre de keptLevel
+    std::size_t nextKept = 0;
+
+    // Moteur instancié pour le contrat courant (politique de payoff et de conditions aux limites), choisi par selectContract()
+    typedef void (FiniteDifferencePricer::*BackwardEngine)();
+    typedef void (FiniteDifferencePricer::*StepEngine)(const double* in, double* out, int m) const;
+    BackwardEngine backward = nullptr; // Payoff à maturité puis remontée de t=T à t=0
+    StepEngine stepper = nullptr; // Un pas de temps (recalculs de la passe adjointe)
+    double lowerCash = 0.0, upperCash = 0.0; // Parties en exp(-r*tau) des conditions aux limites (dérivées en r de la passe adjointe)
+    bool exerciseBelow = false; // Zone d'exercice sous le strike : factorisations éliminées de la dernière ligne vers la première
+    int homogeneity = 1;
+
+    // Coefficients dépendant du temps : les courbes sont constantes par intervalle, les coefficients du stencil (et les factorisations)
+    // ne sont reconstruits qu'au pas où r, sigma ou la ligne de volatilité locale changent effectivement (voir updateCoefficients)
+    MarketCurves market;
+    bool timeDependent = false; // Au moins une courbe fournie
+    bool localVol = false; // sigma dépend aussi de S
+    double stepRate = 0.0, stepSigma = 0.0; // r et sigma des coefficients en place (ceux de params si les courbes sont vides)
+    int localRow = -1; // Ligne de la surface dont nodeSigma est tirée (-1 : aucune)
+    bool coefficientsReady = false; // Coefficients en place pour stepRate, stepSigma et localRow
+    std::vector<double> nodeSigma; // sigma(S_j) en chaque noeud pour la ligne localRow
+    std::vector<double> levelDiscount; // levelDiscount[m] = exp(-intégrale de r entre m*dt et T)
+    double curveLimit = 0.0; // Pas de stabilité du schéma explicite valable sur toutes les courbes
+    bool cashDividends = false; // Dividendes en numéraire : U saute aux dates de détachement
+    std::vector<int> dividendLevel; // Niveau de temps de chaque dividende, dans l'ordre de la remontée (du plus tardif au plus proche)
+    std::vector<int> jumpIndex; // jumpIndex[d*(N+1) + j] : noeud k tel que max(S_j - D, 0) soit dans [S_k, S_k+1]
+    AlignedVector jumpWeight; // Poids de S_k+1 dans l'interpolation correspondante
+    std::vector<double> dividendValue; // dividendValue[m] : valeur en m*dt des dividendes détachés après m*dt
+    AlignedVector jumped; // Buffer du saut, échangé avec U
+    std::size_t nextDividend = 0; // Prochain dividende rencontré par la remontée
+    std::vector<double> nodes; // Abscisses S_0 = 0 < S_1 < ... < S_N = Smax
+    double stretch = 0.0; // Largeur c de la zone resserrée (0 pour une grille uniforme)
+    static constexpr double stretchWidth = 0.1; // c = stretchWidth*K + |S0 - K|/2 : environ la moitié des noeuds tombe dans [K - 3c, K + 3c]
+    int richardsonLevels = 1; // Nombre de grilles du mode interactif Extrapolé
+    double tolerance = 0.0; // Erreur visée du mode interactif Tolérance
+    bool smoothPayoff = false; // Payoff moyenné sur la maille de chaque noeud (grilles de l'extrapolation de Richardson)
+    static constexpr int maxRichardsonLevels = 3;
+    static constexpr int adaptiveStartN = 50; // Première grille du mode tolérance ; les suivantes en sont des multiples
+    static constexpr int adaptiveMaxN = 1 << 15;
+    static constexpr int adaptiveMaxExplicitN = 4000;
+    static constexpr int adaptiveMaxM = 1 << 16;
+    std::vector<std::unique_ptr<FiniteDifferencePricer>> levelPricers; // Pricers des grilles grossières de l'extrapolation, conservés d'un appel à l'autre
+    bool temporalBlocking = true;
+    Precision precision = Precision::Double;
+    int sweepThreads = 1; // Threads demandés pour une résolution (GridSettings::threads, 0 remplacé par le nombre de coeurs)
+    Kernel kernel;
+    StencilKernel stencil; // Noyau du stencil choisi à l'exécution
+    AdjointKernel adjointKernel; // Noyau d'accumulation de la passe adjointe, même jeu d'instructions
+    IncrementKernel<float> floatIncrement; // Noyaux de la remontée en simple précision et en précision mixte, même jeu d'instructions
+    IncrementKernel<double> mixedIncrement;
+    AlignedVector U; // U est le vecteur prix
+    AlignedVector U_old; // Prix au pas de temps précédent (t+dt pendant le calcul, t=dt à la fin)
+
+    // Solveur tridiagonal (algorithme de Thomas) dont la factorisation est calculée une seule fois par grille.
+    // La matrice des schémas implicites ne dépend pas du temps : seule la substitution est refaite à chaque pas.
+    // Avec reversed, l'élimination part de la dernière ligne et la substitution de la première : c'est alors lower qui est modifiée.
+    struct ThomasSolver {
+        std::vector<double> lower; // Sous-diagonale (modifiée par l'élimination si reversed)
+        std::vector<double> cprime; // Sur-diagonale modifiée par l'élimination (telle quelle si reversed)
+        std::vector<double> inv_m; // Inverses des pivots
+        bool reversed = false;
+
+        void resize(std::size_t n) { // Ne réalloue que si n dépasse la capacité
+            lower.resize(n);
+            cprime.resize(n);
+            inv_m.resize(n);
+        }
+
+        void reserve(std::size_t n) {
+            lower.reserve(n);
+            cprime.reserve(n);
+            inv_m.reserve(n);
+        }
+
+        // Factorisation en place : en entrée, lower contient la sous-diagonale, inv_m la diagonale et cprime la sur-diagonale ;
+        // inv_m et cprime sont remplacés par les inverses des pivots et la sur-diagonale modifiée
+        void factorize() {
+            const std::size_t n = inv_m.size();
+            if (reversed) {
+                inv_m[n - 1] = 1.0 / inv_m[n - 1];
+                lower[n - 1] *= inv_m[n - 1];
+                for (std::size_t i = n - 1; i > 0; i--) {
+                    inv_m[i - 1] = 1.0 / (inv_m[i - 1] - cprime[i - 1] * lower[i]);
+                    lower[i - 1] *= inv_m[i - 1];
+                }
+                return;
+            }
+            inv_m[0] = 1.0 / inv_m[0];
+            cprime[0] *= inv_m[0];
+            for (std::size_t i = 1; i < n; i++) {
+                inv_m[i] = 1.0 / (inv_m[i] - lower[i] * cprime[i - 1]);
+                cprime[i] *= inv_m[i];
+            }
+        }
+
+        void solve(double* x) const { // Résout le système en place : x contient le second membre en entrée et la solution en sortie
+            substitute(lower.data(), cprime.data(), inv_m.data(), reversed, inv_m.size(), x);
+        }
+
+        // Élimination et substitution de solve() pour une factorisation de n lignes. Développée en ligne, elle reçoit des grilles
+        // prédéfinies (solveBackwardFixed) un n connu à la compilation.
+        __attribute__((always_inline))
+        static inline void substitute(const double* lower, const double* cprime, const double* inv_m, bool reversed, std::size_t n, double* x) {
+            if (reversed) {
+                x[n - 1] *= inv_m[n - 1];
+                for (std::size_t i = n - 1; i > 0; i--) x[i - 1] = (x[i - 1] - cprime[i - 1] * x[i]) * inv_m[i - 1];
+                for (std::size_t i = 1; i < n; i++) x[i] -= lower[i] * x[i - 1];
+                return;
+            }
+            x[0] *= inv_m[0];
+            for (std::size_t i = 1; i < n; i++) x[i] = (x[i] - lower[i] * x[i - 1]) * inv_m[i];
+            for (std::size_t i = n - 1; i > 0; i--) x[i - 1] -= cprime[i - 1] * x[i];
+        }
+
+        // Variante de Brennan et Schwartz pour l'exercice anticipé : chaque inconnue est projetée sur floor (x >= floor) au fil
+        // de la substitution. Le résultat est celui du problème d'obstacle si la zone d'exercice est d'un seul tenant et que la
+        // substitution la traverse en premier : S grand pour un call (ordre normal), S petit pour un put (reversed).
+        // Le coût est celui de solve().
+        void solveProjected(double* x, const double* floor) const {
+            const std::size_t n = inv_m.size();
+            if (reversed) {
+                eliminateReversed(x);
+                x[0] = std::max(x[0], floor[0]);
+                for (std::size_t i = 1; i < n; i++) x[i] = std::max(x[i] - lower[i] * x[i - 1], floor[i]);
+                return;
+            }
+            eliminate(x);
+            x[n - 1] = std::max(x[n - 1], floor[n - 1]);
+            for (std::size_t i = n - 1; i > 0; i--) {
+                x[i - 1] = std::max(x[i - 1] - cprime[i - 1] * x[i], floor[i - 1]);
+            }
+        }
+
+        void eliminate(double* x) const {
+            const std::size_t n = inv_m.size();
+            x[0] *= inv_m[0];
+            for (std::size_t i = 1; i < n; i++) {
+                x[i] = (x[i] - lower[i] * x[i - 1]) * inv_m[i];
+            }
+        }
+
+        void eliminateReversed(double* x) const {
+            const std::size_t n = inv_m.size();
+            x[n - 1] *= inv_m[n - 1];
+            for (std::size_t i = n - 1; i > 0; i--) {
+                x[i - 1] = (x[i - 1] - cprime[i - 1] * x[i]) * inv_m[i - 1];
+            }
+        }
+    };
+
+    ThomasSolver solver; // Factorisation du schéma choisi
+    ThomasSolver startSolver; // Factorisation implicite utilisée pour les premiers pas de Crank-Nicolson (lissage de Rannacher)
+
+    // Factorisation de Thomas arrondie en float (remontée en simple précision ou mixte) ; la substitution est faite dans le type des prix
+    struct SingleThomasSolver {
+        AlignedFloatVector lower, cprime, inv_m;
+        bool reversed = false;
+
+        void reserve(std::size_t n) {
+            lower.reserve(n);
+            cprime.reserve(n);
+            inv_m.reserve(n);
+        }
+
+        void assign(const ThomasSolver& s) { // Conversion d'une factorisation en double (sans allocation une fois les buffers dimensionnés)
+            lower.assign(s.lower.begin(), s.lower.end());
+            cprime.assign(s.cprime.begin(), s.cprime.end());
+            inv_m.assign(s.inv_m.begin(), s.inv_m.end());
+            reversed = s.reversed;
+        }
+
+        // Résout le système pour le second membre x (même ordre des opérations que ThomasSolver::solve) et remplace x par base + solution :
+        // l'ajout est fait par la substitution, la solution courante restant dans un registre
+        template <class Real>
+        void solveAdded(Real* x, const Real* base) const {
+            const std::size_t n = inv_m.size();
+            if (reversed) {
+                x[n - 1] *= inv_m[n - 1];
+                for (std::size_t i = n - 1; i > 0; i--) x[i - 1] = (x[i - 1] - cprime[i - 1] * x[i]) * inv_m[i - 1];
+                Real d = x[0];
+                x[0] = base[0] + d;
+                for (std::size_t i = 1; i < n; i++) {
+                    d = x[i] - lower[i] * d;
+                    x[i] = base[i] + d;
+                }
+                return;
+            }
+            x[0] *= inv_m[0];
+            for (std::size_t i = 1; i < n; i++) x[i] = (x[i] - lower[i] * x[i - 1]) * inv_m[i];
+            Real d = x[n - 1];
+            x[n - 1] = base[n - 1] + d;
+            for (std::size_t i = n - 1; i > 0; i--) {
+                d = x[i - 1] - cprime[i - 1] * d;
+                x[i - 1] = base[i - 1] + d;
+            }
+        }
+    };
+
+    struct SinglePrecisionGrid {
+        AlignedFloatVector a, c, e; // Incrément dt*L U^m = a*(U_j-1 - U_j) + c*(U_j+1 - U_j) + e*U_j (voir IncrementKernel)
+        AlignedFloatVector U, U_old; // Prix en float (Precision::Float ; la précision mixte travaille directement dans U et U_old)
+        SingleThomasSolver solver, startSolver;
+    };
+    SinglePrecisionGrid single;
+
+    // Solveur tridiagonal partitionné d'une résolution sur plusieurs threads (réduction par blocs, variante de la réduction cyclique
+    // à un seul niveau qui garde le travail en O(n)) : les lignes sont découpées en P blocs contigus, factorisés chacun par Thomas.
+    // Dans le bloc k, x = y - xl * v - xr * w, où y est la solution locale, xl et xr les inconnues voisines des blocs k-1 et k+1, et
+    // v, w les pointes (spikes) T_k^{-1} l e_0 et T_k^{-1} u e_fin. Les extrémités des blocs forment un système réduit tridiagonal
+    // par blocs 2x2 de P-1 interfaces, que chaque thread résout pour son compte (quelques dizaines d'opérations par interface).
+    struct PartitionedSolver {
+        std::vector<ThomasSolver> blocks;
+        AlignedVector v, w; // Pointes, indexées par noeud
+        std::vector<double> spikeEnds; // Par bloc : v et w à la première ligne, puis à la dernière
+        std::vector<double> ends; // Par bloc : solution locale y à la première et à la dernière ligne (second membre du système réduit)
+        std::vector<double> dinv, q; // Par interface : D_i^{-1} et A_i D_{i-1}^{-1} de la factorisation par blocs (matrices 2x2 par lignes)
+        std::vector<double> interfaces; // Inconnues p du système réduit, une copie par thread (interfaceStride doubles chacune)
+
+        static std::size_t interfaceStride(int parts) { return (2 * static_cast<std::size_t>(parts) + 7) / 8 * 8; } // Ligne de cache entière par thread
+
+        void resize(int parts, int nodes) {
+            blocks.resize(parts);
+            v.resize(nodes);
+            w.resize(nodes);
+            spikeEnds.resize(4 * parts);
+            ends.resize(2 * parts);
+            dinv.resize(4 * parts);
+            q.resize(4 * parts);
+            interfaces.resize(interfaceStride(parts) * parts);
+        }
+
+        // Interface i (1..P-1) entre les blocs i-1 et i, inconnues p_i = (dernière du bloc i-1, première du bloc i) :
+        // B_i = [[1, we_{i-1}], [vs_i, 1]], A_i = [[ve_{i-1}, 0], [0, 0]] (vers p_{i-1}), C_i = [[0, 0], [0, ws_i]] (vers p_{i+1})
+        void reduce() {
+            const int parts = static_cast<int>(blocks.size());
+            for (int i = 1; i < parts; i++) {
+                const double* prev = &spikeEnds[4 * (i - 1)];
+                const double* next = &spikeEnds[4 * i];
+                double d[4] = {1.0, prev[3], next[0], 1.0};
+                double* qi = &q[4 * (i - 1)];
+                qi[0] = qi[1] = qi[2] = qi[3] = 0.0;
+                if (i > 1) { // D_i = B_i - A_i D_{i-1}^{-1} C_{i-1}
+                    const double* di = &dinv[4 * (i - 2)];
+                    qi[0] = prev[2] * di[0];
+                    qi[1] = prev[2] * di[1];
+                    d[1] -= qi[1] * prev[1];
+                }
+                const double invDet = 1.0 / (d[0] * d[3] - d[1] * d[2]);
+                double* inv = &dinv[4 * (i - 1)];
+                inv[0] = d[3] * invDet;
+                inv[1] = -d[1] * invDet;
+                inv[2] = -d[2] * invDet;
+                inv[3] = d[0] * invDet;
+            }
+        }
+
+        // Résout le système réduit à partir de ends : p[2(i-1)] et p[2(i-1)+1] reçoivent p_i
+        void solveInterfaces(double* p) const {
+            const int parts = static_cast<int>(blocks.size());
+            for (int i = 1; i < parts; i++) { // z_i = r_i - Q_i z_{i-1}
+                double* z = p + 2 * (i - 1);
+                z[0] = ends[2 * (i - 1) + 1];
+                z[1] = ends[2 * i];
+                if (i > 1) z[0] -= q[4 * (i - 1)] * z[-2] + q[4 * (i - 1) + 1] * z[-1];
+            }
+            for (int i = parts - 1; i > 0; i--) { // p_i = D_i^{-1} (z_i - C_i p_{i+1})
+                double* z = p + 2 * (i - 1);
+                const double z1 = i < parts - 1 ? z[1] - spikeEnds[4 * i + 1] * z[3] : z[1];
+                const double* inv = &dinv[4 * (i - 1)];
+                const double z0 = z[0];
+                z[0] = inv[0] * z0 + inv[1] * z1;
+                z[1] = inv[2] * z0 + inv[3] * z1;
+            }
+        }
+    };
+    PartitionedSolver partition, startPartition; // Schéma choisi et démarrage implicite de Crank-Nicolson
+    std::vector<AlignedVector> haloCopies; // Copies locales x et y de chaque thread du schéma explicite parallèle, gardées d'un appel à l'autre
+
+    // Barrière à attente active entre les threads d'une résolution, franchie une ou deux fois par pas : bien moins chère qu'une
+    // attente sur condition pour des pas de quelques microsecondes (le thread cède le coeur après une attente prolongée)
+    class SpinBarrier {
+    public:
+        explicit SpinBarrier(int parties) : parties(parties) {}
+        void wait() {
+            const unsigned generation = phase.load(std::memory_order_acquire);
+            if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == parties) {
+                arrived.store(0, std::memory_order_relaxed);
+                phase.store(generation + 1, std::memory_order_release);
+                return;
+            }
+            for (int spins = 0; phase.load(std::memory_order_acquire) == generation; spins++) {
+                if (spins > 4096) std::this_thread::yield();
+            }
+        }
+    private:
+        const int parties;
+        alignas(64) std::atomic<int> arrived{0};
+        alignas(64) std::atomic<unsigned> phase{0};
+    };
+    static constexpr int rannacherSteps = 2; // Nombre de pas implicites amortissant les oscillations dues au point anguleux du payoff
+
+    // Coefficients de la partie explicite du schéma, indépendants du temps : calculés une fois par (grille, r, sigma, dt, schéma).
+    // Pour le schéma explicite ce sont les a, b, c de la formule de récurrence ; pour le schéma theta ceux du second membre.
+    // Les factorisations de Thomas ont la même clé et sont recalculées en même temps.
+    struct CoefficientTable {
+        AlignedVector a, b, c; // Indexés par j (les entrées 0 et N ne servent pas)
+        double upperCoupling = 0.0; // alpha + beta au noeud N-1 : reporte la condition limite U[N] dans le second membre
+        double lowerCoupling = 0.0; // alpha - beta au noeud 1 : même rôle pour U[0] (non nul pour le put résolu directement)
+        double discount = 1.0; // exp(-r*dt)
+        bool valid = false;
+        int N = 0;
+        double dS = 0.0, stretch = 0.0, r = 0.0, q = 0.0, sigma = 0.0, dt = 0.0;
+        Scheme scheme = Scheme::Explicit;
+        bool reversed = false; // Sens d'élimination des factorisations
+
+        bool matches(int N_, double dS_, double stretch_, double r_, double q_, double sigma_, double dt_, Scheme scheme_, bool reversed_) const {
+            return valid && N == N_ && dS == dS_ && stretch == stretch_ && r == r_ && q == q_ && sigma == sigma_ && dt == dt_ && scheme == scheme_
+                && reversed == reversed_;
+        }
+    };
+
+    CoefficientTable coef;
+
+    // Solution à t=0 du dernier appel à solve() : elle donne le prix pour tout S de [0, Smax], si bien qu'un nouveau S0 sur le même
+    // marché et la même grille se lit par interpolation, sans nouvelle résolution. Une grille uniforme ne dépend pas de S0 (Smax = 4K) :
+    // la lecture donne exactement le résultat d'une nouvelle résolution. Une grille resserrée dépend de l'ancien S0 : elle n'est
+    // réutilisée que tant que S0 reste à moins de c/2 de celui-ci (les noeuds y sont encore resserrés comme ceux d'une nouvelle grille).
+    // Toute autre modification de la grille (configureGrid, computeOptionPrice) invalide la solution.
+    struct SolutionCache {
+        bool valid = false;
+        double K = 0.0, r = 0.0, sigma = 0.0, T = 0.0, q = 0.0, Smax = 0.0;
+        int N = 0, M = 0; // M demandé (0 : automatique)
+        Scheme scheme = Scheme::Explicit;
+        Spacing spacing = Spacing::Uniform;
+        Kernel kernel = Kernel::Auto;
+        bool temporalBlocking = true, smoothPayoff = false, recorded = false;
+        Exercise exercise = Exercise::European;
+        Precision precision = Precision::Double;
+        Payoff payoff = Payoff::Vanilla;
+        double type = 1.0, barrier = 0.0;
+        double low = 0.0, high = 0.0; // Plage de S0 (bornes exclues) servie sans nouvelle résolution
+
+        // dates, curves, kept : dates d'exercice, courbes et dates des niveaux gardés de la solution enregistrée (exerciseDates, market et snapshotTimes du pricer)
+        bool matches(const Parameters& p, const GridSettings& g, double smax, bool smoothed, const std::vector<double>& dates, const MarketCurves& curves,
+                     const std::vector<double>& kept) const {
+            return valid && K == p.K && r == p.r && sigma == p.sigma && T == p.T && q == p.q && Smax == smax && N == g.N && M == g.M
+                && scheme == g.scheme && spacing == g.spacing && (g.kernel == Kernel::Auto || kernel == g.kernel)
+                && temporalBlocking == g.temporalBlocking && precision == g.precision && smoothPayoff == smoothed && (recorded || !g.sensitivities)
+                && exercise == g.exercise && payoff == g.payoff && type == p.type && barrier == g.barrier
+                && (exercise != Exercise::Bermudan || dates == g.exerciseDates) && curves == g.market && kept == g.snapshotTimes
+                && p.S0 > low && p.S0 < high;
+        }
+    };
+
+    SolutionCache solution;
+    GridSettings lastGrid; // Réglages du dernier appel à price(), repris par reprice()
+
+    // Instrumentation : les compteurs et la trace sont mutables pour que les lectures const (resultsAt, displayResults) soient mesurées
+    struct TraceEvent {
+        Phase phase;
+        double start; // En microsecondes depuis traceClock() = 0
+        double duration; // Inclusive (phases imbriquées comprises)
+        int thread;
+    };
+    struct PhaseTimer;
+    struct Instrumentation {
+        PricingStats stats;
+        std::vector<TraceEvent> events;
+        PhaseTimer* current = nullptr; // Phase en cours, dont la durée est retirée de la phase englobante
+        int depth = 0; // Appels de calcul imbriqués (price appelé par priceStrikeLadder ou run) : seul le plus externe remet les compteurs à zéro
+    };
+    mutable Instrumentation instrumentation;
+    static constexpr std::size_t maxTraceEvents = std::size_t(1) << 20; // Au-delà (grands portefeuilles), les phases sont comptées mais plus tracées
+
+    static double traceClock() { // Microsecondes depuis le premier appel, commun à tous les pricers pour aligner les threads dans la trace
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    struct PhaseTimer { // Chronomètre d'une phase, de sa construction à la fin de la portée (EDP_PHASE)
+        Instrumentation& owner;
+        Phase phase;
+        PhaseTimer* parent;
+        double start;
+        double nested = 0.0; // Durée des phases imbriquées
+
+        PhaseTimer(Instrumentation& owner, Phase phase) : owner(owner), phase(phase), parent(owner.current), start(traceClock()) {
+            owner.current = this;
+        }
+        ~PhaseTimer() {
+            const double elapsed = traceClock() - start;
+            owner.stats.seconds[static_cast<int>(phase)] += (elapsed - nested) * 1e-6;
+            if (parent) parent->nested += elapsed;
+            owner.current = parent;
+            if (owner.events.size() < maxTraceEvents) owner.events.push_back({phase, start, elapsed, 0});
+        }
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+    };
+
+    struct CallScope { // Portée d'un appel de calcul public (EDP_PRICING_CALL)
+        Instrumentation& owner;
+        explicit CallScope(Instrumentation& owner) : owner(owner) {
+            if (owner.depth++ == 0) owner.stats = PricingStats();
+        }
+        ~CallScope() { owner.depth--; }
+        CallScope(const CallScope&) = delete;
+        CallScope& operator=(const CallScope&) = delete;
+    };
+
+    void mergeStats(const FiniteDifferencePricer& other, int thread) { // Ajoute les compteurs et la trace d'un pricer de l'extrapolation, sur la ligne thread
+        const PricingStats& s = other.instrumentation.stats;
+        for (int i = 0; i < static_cast<int>(Phase::Count); i++) instrumentation.stats.seconds[i] += s.seconds[i];
+        instrumentation.stats.timeSteps += s.timeSteps;
+        instrumentation.stats.nodeUpdates += s.nodeUpdates;
+        instrumentation.stats.solves += s.solves;
+        for (TraceEvent e : other.instrumentation.events) {
+            if (instrumentation.events.size() >= maxTraceEvents) break;
+            e.thread = thread;
+            instrumentation.events.push_back(e);
+        }
+    }
+
+    double maxVolatility() const { // sigma maximal sur la grille et la maturité (volatilité locale, courbe ou constante)
+        if (localVol) return *std::max_element(market.localVolatility.values.begin(), market.localVolatility.values.end());
+        if (!market.volatility.empty()) return *std::max_element(market.volatility.values.begin(), market.volatility.values.end());
+        return params.sigma;
+    }
+
+    // Passe adjointe (Vega et Rho) : la passe avant enregistre un niveau de temps tous les tapeStride pas (points de reprise),
+    // la passe adjointe remonte de t=0 à t=T en recalculant les niveaux intermédiaires de chaque segment.
+    // Si toute la grille espace-temps tient dans tapeBudget doubles, tous les niveaux sont enregistrés et rien n'est recalculé.
+    static constexpr std::size_t tapeBudget = std::size_t(1) << 22; // 32 Mo
+    bool recording = false;
+    int tapeStride = 1;
+    std::vector<double> tape; // Niveaux U^M, U^{M-s}, U^{M-2s}, ... (N+1 valeurs chacun)
+    std::vector<double> segment; // Niveaux recalculés d'un segment
+    std::vector<const double*> levels; // levels[i] pointe sur U^{mHi-i} dans le segment courant
+    std::vector<double> lambda, lambdaNext, rhsBar; // Adjoints des niveaux de temps
+    std::vector<double> sigmaLo, sigmaHi, rateLo, rateHi; // Dérivées par rapport à sigma et r des coefficients (j-1) et (j+1) de dt*L
+    AlignedVector adjointA, adjointC; // Coefficients du stencil transposé : adjointA[i] = c[i-1], adjointC[i] = a[i+1]
+    ThomasSolver adjointSolver, adjointStartSolver; // Factorisations des matrices transposées
+    bool adjointValid = false; // Factorisations transposées à jour par rapport à coef
+
+    // Découpage espace-temps du schéma explicite : tileSteps niveaux de temps sont avancés sur tileWidth noeuds tant que les données sont dans le cache L2
+    // (environ 40 octets par noeud pour U, U_old et les coefficients). La largeur doit rester supérieure au nombre de niveaux par tuile.
+    static constexpr int tiledMinN = 16384;
+    static constexpr int tileWidth = 4096;
+    static constexpr int tileSteps = 32;
+
+    // Résolution sur plusieurs threads : chaque thread prend au moins parallelMinChunk noeuds (en deçà, la synchronisation coûte plus
+    // que le calcul) ; le schéma explicite avance de haloSteps pas entre deux barrières sur une copie locale élargie de haloSteps noeuds
+    static constexpr int parallelMinChunk = 8192;
+    static constexpr int haloSteps = 32;
+
+    int sweepTeam() const { // Nombre de threads de la résolution courante (1 : parcours séquentiel)
+        if (sweepThreads <= 1 || earlyExercise || timeDependent || cashDividends || recording) return 1;
+        return std::max(1, std::min(sweepThreads, (N - 1) / parallelMinChunk));
+    }
+    int chunkBegin(int k, int team) const { // Premier noeud de la plage du thread k (les noeuds intérieurs 1..N-1 sont répartis également)
+        return 1 + static_cast<int>(static_cast<long long>(N - 1) * k / team);
+    }
+
+    static int tapeStrideFor(int M, int N) { // 1 si toute la grille tient dans tapeBudget, sinon environ sqrt(M) niveaux par segment
+        const std::size_t levelCount = static_cast<std::size_t>(M) * (N + 1);
+        return levelCount <= tapeBudget ? 1 : static_cast<int>(std::ceil(std::sqrt(static_cast<double>(M))));
+    }
+
+    // Style d'exercice du contrat
+    void configureExercise(Exercise style, const std::vector<double>& dates) {
+        exercise = style;
+        earlyExercise = style != Exercise::European;
+        if (style == Exercise::Bermudan) exerciseDates.assign(dates.begin(), dates.end());
+        else exerciseDates.clear();
+    }
+
+    // Courbes de marché du contrat (params doit déjà être en place) : vides, les coefficients restent ceux de params.r et params.sigma
+    void configureMarket(const MarketCurves& curves) {
+        market = curves; // Les buffers des courbes sont réutilisés d'un contrat à l'autre
+        timeDependent = !curves.constantCoefficients();
+        cashDividends = !curves.dividends.empty();
+        localVol = !curves.localVolatility.empty();
+        stepRate = params.r;
+        stepSigma = params.sigma;
+        localRow = -1;
+    }
+
+    bool adjointAvailable() const { // La passe adjointe suppose des coefficients constants et ne dérive ni la projection de l'exercice anticipé ni les sauts
+        return !earlyExercise && !timeDependent && !cashDividends;
+    }
+
+    // Instancie le moteur pour la politique C
+    template <class C>
+    void useContract() {
+        backward = &FiniteDifferencePricer::solveContract<C>;
+        stepper = &FiniteDifferencePricer::stepContract<C>;
+        lowerCash = C::lowerCash(params.K);
+        upperCash = C::upperCash(params.K);
+        exerciseBelow = C::exerciseBelow;
+        homogeneity = C::homogeneity;
+    }
+
+    void selectContract() { // Politique du contrat courant (payoff et type de params)
+        const bool call = params.type == 1;
+        switch (payoff) {
+        case Payoff::Digital:
+            if (call) useContract<DigitalCallPayoff>(); else useContract<DigitalPutPayoff>();
+            break;
+        case Payoff::UpAndOut:
+            if (call) useContract<UpAndOut<CallPayoff>>(); else useContract<UpAndOut<PutPayoff>>();
+            break;
+        default:
+            if (call) useContract<CallPayoff>(); else useContract<PutPayoff>();
+            break;
+        }
+    }
+
+    double contractSmax(const Parameters& p, const GridSettings& g) const { // Borne de la grille : 4K, ou la barrière
+        return g.payoff == Payoff::UpAndOut ? g.barrier : 4.0 * p.K;
+    }
+
+    // Niveaux de temps où l'option peut être exercée : tous pour une option américaine, le niveau le plus proche
+    // de chaque date pour une option bermudéenne (les dates hors de [0, T) sont ignorées, l'exercice à T étant le payoff)
+    void scheduleExercise() {
+        exerciseLevel.assign(M + 1, exercise == Exercise::American ? 1 : 0);
+        for (double t : exerciseDates) {
+            const double m = std::round(t / dt);
+            if (m >= 0.0 && m < M) exerciseLevel[static_cast<int>(m)] = 1;
+        }
+    }
+
+    // Niveaux intermédiaires demandés (snapshotTimes), ramenés au niveau de temps le plus proche, au plus M-1 comme les dividendes
+    // (t = 0 est la grille U finale ; les dates hors de (0, T) sont ignorées)
+    void scheduleSnapshots() {
+        keptLevel.clear();
+        for (double t : snapshotTimes) {
+            if (!(t > 0.0 && t < params.T)) continue;
+            const int m = std::min(static_cast<int>(std::round(t / dt)), M - 1);
+            if (m >= 1) keptLevel.push_back(m);
+        }
+        std::sort(keptLevel.begin(), keptLevel.end(), [](int a, int b) { return a > b; });
+        keptLevel.erase(std::unique(keptLevel.begin(), keptLevel.end()), keptLevel.end());
+        keptPrices.resize(keptLevel.size() * (N + 1));
+        nextKept = 0;
+    }
+
+    void keepLevel(int level) { // Après chaque pas de la remontée pas à pas, U contenant le niveau level
+        if (nextKept < keptLevel.size() && keptLevel[nextKept] == level) {
+            std::copy(U.begin(), U.begin() + N + 1, keptPrices.begin() + static_cast<std::ptrdiff_t>(nextKept * (N + 1)));
+            nextKept++;
+        }
+    }
+
+    // Dividendes en numéraire, ramenés au niveau de temps le plus proche (au plus M-1 : un détachement à maturité ne change rien) :
+    // table d'interpolation de chaque saut et valeur actuelle des dividendes restants pour la condition en Smax.
+    // À appeler une fois le pas de temps et r connus (après buildCoefficients ou prepareCurves).
+    void scheduleDividends() {
+        const CashDividends& d = market.dividends;
+        const std::size_t n = static_cast<std::size_t>(N) + 1;
+        dividendLevel.clear();
+        dividendValue.assign(M + 1, 0.0);
+        jumpIndex.resize(d.amounts.size() * n);
+        jumpWeight.resize(d.amounts.size() * n);
+        jumped.resize(n);
+        for (std::size_t i = d.amounts.size(); i-- > 0;) {
+            const double t = d.times[i], D = d.amounts[i];
+            if (!(t > 0.0 && t < params.T) || D == 0.0) continue;
+            const int level = std::min(static_cast<int>(std::round(t / dt)), M - 1);
+            const std::size_t row = dividendLevel.size() * n;
+            dividendLevel.push_back(level);
+            int k = 0;
+            for (int j = 0; j <= N; j++) { // S_j - D croît avec j : les intervalles se trouvent en un seul parcours
+                const double x = std::max(nodes[j] - D, 0.0);
+                while (k < N - 1 && nodes[k + 1] <= x) k++;
+                jumpIndex[row + j] = k;
+                jumpWeight[row + j] = (x - nodes[k]) / (nodes[k + 1] - nodes[k]);
+            }
+            for (int m = 0; m < level; m++) {
+                const double discount = timeDependent ? levelDiscount[m] / levelDiscount[level] : std::exp(-params.r * (level - m) * dt);
+                dividendValue[m] += D * discount;
+            }
+        }
+        nextDividend = 0;
+    }
+
+    // Sauts des dividendes détachés au niveau level : U(S, t-) = U(max(S - D, 0), t+), interpolé linéairement par la table
+    // de scheduleDividends (un seul passage sans branchement par dividende), puis exercice anticipé juste avant le détachement.
+    // Renvoie true si U a sauté.
+    bool applyDividends(int level) {
+        bool jumpedLevel = false;
+        while (nextDividend < dividendLevel.size() && dividendLevel[nextDividend] == level) {
+            const std::size_t row = nextDividend * (static_cast<std::size_t>(N) + 1);
+            const int* k = jumpIndex.data() + row;
+            const double* w = jumpWeight.data() + row;
+            const double* u = U.data();
+            double* out = jumped.data();
+            for (int j = 0; j <= N; j++) out[j] = u[k[j]] + w[j] * (u[k[j] + 1] - u[k[j]]);
+            U.swap(jumped);
+            nextDividend++;
+            jumpedLevel = true;
+        }
+        if (jumpedLevel && earlyExercise && exerciseLevel[level]) project(U.data());
+        return jumpedLevel;
+    }
+
+    void project(double* out) const { // Exercice anticipé dans le schéma explicite : U = max(U, valeur d'exercice)
+        const double* floor = intrinsic.data();
+        for (int j = 0; j <= N; j++) out[j] = std::max(out[j], floor[j]);
+    }
+
+    // Borne Smax proche de 4K telle que S0 soit un noeud de la grille uniforme courante et de toutes les grilles dont N est un multiple
+    double alignedSmax() const {
+        if (payoff == Payoff::UpAndOut) return barrier; // La barrière reste la borne : S0 n'est en général pas un noeud
+        const double smax = 4.0 * params.K;
+        if (spacing != Spacing::Uniform || params.S0 >= smax) return smax;
+        return N * params.S0 / std::max(1.0, std::round(params.S0 * N / smax));
+    }
+
+    // Élimine les termes d'erreur en h^p1 puis h^p2 de résultats v[0..levels-1] obtenus avec des pas h, h/2, h/4
+    static double extrapolate(const double* v, int levels, int p1, int p2) {
+        const double f1 = static_cast<double>(1 << p1), f2 = static_cast<double>(1 << p2);
+        const double a = (f1 * v[1] - v[0]) / (f1 - 1.0);
+        if (levels == 2) return a;
+        const double b = (f1 * v[2] - v[1]) / (f1 - 1.0);
+        return (f2 * b - a) / (f2 - 1.0);
+    }
+
+    void inputParameters() {
+        std::cout << "Entrez les paramètres de l'option :\n";
+        do {
+        std::cout << "Type d'option (0 pour put, 1 pour call) : ";
+        std::cin >> params.type;
+        if (typeError(params.type)) {
+            std::cerr << typeError(params.type) << "\n";
+        }} while (typeError(params.type));
+
+        do {
+        std::cout << "Prix de l'actif sous-jacent initial (S0) : ";
+        std::cin >> params.S0;
+        if (spotError(params.S0)) {
+            std::cerr << spotError(params.S0) << "\n";
+        }} while (spotError(params.S0));
+
+        do {
+        std::cout << "Prix Strike (K) : ";
+        std::cin >> params.K;
+        if (strikeError(params.K)) {
+            std::cerr << strikeError(params.K) << "\n";
+        }} while (strikeError(params.K));
+
+        do {
+        std::cout << "Taux sans risque (r) : ";
+        std::cin >> params.r;
+        if (rateError(params.r)) {
+            std::cerr << rateError(params.r) << "\n";
+        }} while (rateError(params.r));
+        
+        do {
+        std::cout << "Volatilité (sigma) : ";
+        std::cin >> params.sigma;
+        if (volatilityError(params.sigma)) {
+            std::cerr << volatilityError(params.sigma) << "\n";
+        }} while (volatilityError(params.sigma));
+
+        do {
+        std::cout << "Taux de dividende continu (q) : ";
+        std::cin >> params.q;
+        if (dividendYieldError(params.q)) {
+            std::cerr << dividendYieldError(params.q) << "\n";
+        }} while (dividendYieldError(params.q));
+        
+        do {
+        std::cout << "Maturité (T) : ";
+        std::cin >> params.T;
+        if (maturityError(params.T)) {
+            std::cerr << maturityError(params.T) << "\n";
+        }} while (maturityError(params.T));
+        Smax = 4.0 * params.K;
+    }
+
+    static bool validParameters(const Parameters& p) { // Mêmes règles que la saisie interactive
+        return parameterError(p) == nullptr;
+    }
+
+    Exercise chooseExercise() {
+        std::cout << "Choisissez le style d'exercice :\n";
+        std::cout << "1. Européen (à maturité seulement)\n";
+        std::cout << "2. Américain (à tout instant jusqu'à maturité)\n";
+        int choice;
+        std::cin >> choice;
+        switch (choice) {
+        case 2:
+            return Exercise::American;
+        case 1:
+            return Exercise::European;
+        default:
+            std::cerr << "Choix invalide, exercice européen par défaut.\n";
+            return Exercise::European;
+        }
+    }
+
+    Scheme chooseScheme() {
+        std::cout << "Choisissez un schéma temporel :\n";
+        std::cout << "1. Explicite (pas temporel contraint par la condition de stabilité)\n";
+        std::cout << "2. Implicite (inconditionnellement stable, précision d'ordre 1 en temps)\n";
+        std::cout << "3. Crank-Nicolson (inconditionnellement stable, précision d'ordre 2 en temps)\n";
+        int choice;
+        std::cin >> choice;
+        switch (choice) {
+        case 2:
+            return Scheme::Implicit;
+        case 3:
+            return Scheme::CrankNicolson;
+        case 1:
+            return Scheme::Explicit;
+        default:
+            std::cerr << "Schéma invalide, utilisation du schéma explicite par défaut.\n";
+            return Scheme::Explicit;
+        }
+    }
+
+    int chooseMode() {
+        std::cout << "Choisissez un mode :\n";
+        std::cout << "1. Précis (petits pas, mais exécution lente)\n";
+        std::cout << "2. Rapide (grands pas, mais moins précis)\n";
+        std::cout << "3. Personnalisé (nombre de pas spatial à choisir) \n";
+        std::cout << "4. Resserré (grille non uniforme concentrée autour de S0 et K : précision du mode Précis avec quatre fois moins de noeuds)\n";
+        std::cout << "5. Extrapolé (grilles N = 100, 200 et 400 combinées par extrapolation de Richardson : plus précis que le mode Précis et bien plus rapide)\n";
+        std::cout << "6. Tolérance (erreur absolue visée sur le prix : la grille est choisie automatiquement)\n";
+        int mode;
+        std::cin >> mode;
+        return mode;
+    }
+
+    void configureMode(int mode) {
+        int M_requested = 0; // 0 : nombre de pas temporels choisi automatiquement
+        switch (mode) {
+        case 1: // Précis
+            N = 2000;
+            break;
+        case 2: // Rapide
+            N = 100;
+            break;
+        case 4: // Resserré
+            N = 500;
+            spacing = Spacing::Stretched;
+            break;
+        case 5: // Extrapolé
+            N = 100;
+            richardsonLevels = 3;
+            break;
+        case 6: // Tolérance
+            do {
+                std::cout << "Erreur absolue visée sur le prix : ";
+                std::cin >> tolerance;
+                if (!(tolerance > 0)) std::cerr << "Erreur : la tolérance doit être strictement positive.\n";
+            } while (!(tolerance > 0));
+            return; // La grille sera choisie par priceToTolerance
+
+        case 3: // Personnalisé
+            std::cout << "Entrez le nombre de pas spatiaux (N) : ";
+            std::cin >> N;
+            if (scheme != Scheme::Explicit) { // Les schémas implicites laissent le choix du pas temporel
+                std::cout << "Entrez le nombre de pas temporels (M) : ";
+                std::cin >> M_requested;
+                M_requested = std::max(M_requested, 1);
+            }
+            break;
+        default:
+            std::cerr << "Mode invalide, utilisation du mode Rapide par défaut.\n";
+            N = 100;
+            break;;
+        }
+
+        configureGrid(M_requested);
+        std::cout << "Pas temporel calculé (dt) : " << dt << ", Nombre de pas temporels (M) : " << M << "\n";
+    }
+
+    void configureGrid(int M_requested) { // Calcule dS, dt et M à partir de N (M_requested > 0 impose M pour les schémas implicites)
+        EDP_PHASE(Configure);
+        solution.valid = false;
+        // Définir des bornes dynamiques pour dt et M
+        // Nécessaire dans des cas extrêmes où la volatilité est très faible et où la saturation de la condition de stabilité mène à des valeurs très petites pour M.
+        const int M_target = 100;  // Minimum pour le nombre de pas temporels
+        double dt_max = params.T / M_target;
+        
+        dS = Smax / N; 
+        buildNodes();
+        if (scheme == Scheme::Explicit) {
+            if (timeDependent) curveLimit = curveStabilityLimit();
+            dt = std::min(timeDependent ? curveLimit : stabilityLimit(), dt_max); // Sature la condition de stabilité
+            M = static_cast<int>(params.T / dt) + 1;
+            if (M_requested >= M) { // Plus de pas que le minimum de stabilité : M est retenu tel quel
+                M = M_requested;
+                dt = params.T / M;
+            }
+        } else {
+            // Aucune contrainte de stabilité : M est choisi pour la précision (quelques centaines de pas suffisent)
+            // Une grille resserrée est environ cinq fois plus fine que la grille uniforme près de K : le pas temporel suit
+            const int M_auto = spacing == Spacing::Uniform ? N / 4 : N;
+            M = M_requested > 0 ? M_requested : std::max(M_target, M_auto);
+            dt = params.T / M;
+        }
+#ifdef EDP_INSTRUMENTATION
+        const double sigma = maxVolatility();
+        instrumentation.stats.stabilityRatio = dt * sigma * sigma * Smax * Smax / (dS * dS);
+#endif
+    }
+
+    bool checkStability() const { // Vérifie si la condition de stabilité du modèle est bien respectée (devrait toujours l'être car dans les 3 modes le pas de temps est choisi afin de respecter cette contrainte)
+        if (scheme != Scheme::Explicit) return true; // Les schémas implicite et Crank-Nicolson sont inconditionnellement stables
+        return dt <= (timeDependent ? curveLimit : stabilityLimit());
+    }
+
+    double stabilityLimit() const { // Plus grand pas de temps du schéma explicite (coefficient b_j >= -r*dt en chaque noeud) pour stepRate et stepSigma
+        if (spacing == Spacing::Uniform && !localVol) return (dS * dS) / (stepSigma * stepSigma * Smax * Smax);
+        double limit = std::numeric_limits<double>::infinity();
+        for (int j = 1; j < N; j++) {
+            const double S = nodes[j];
+            const double hm = S - nodes[j - 1], hp = nodes[j + 1] - S;
+            const double sigma = nodeVolatility(j);
+            const double rate = sigma * sigma * S * S - (stepRate - params.q) * S * (hp - hm); // -centre/dt multiplié par hm*hp
+            if (rate > 0.0) limit = std::min(limit, hm * hp / rate);
+        }
+        return limit;
+    }
+
+    // Pas de stabilité valable à toutes les dates : sigma maximal (en chaque noeud pour la volatilité locale) et r extrême,
+    // minimal ou maximal selon le signe de la dissymétrie des mailles
+    double curveStabilityLimit() {
+        const std::vector<double>& rates = market.rate.values;
+        const double rMin = rates.empty() ? params.r : *std::min_element(rates.begin(), rates.end());
+        const double rMax = rates.empty() ? params.r : *std::max_element(rates.begin(), rates.end());
+        const std::vector<double>& vols = market.volatility.values;
+        stepSigma = vols.empty() ? params.sigma : *std::max_element(vols.begin(), vols.end());
+        if (localVol) {
+            const LocalVolatility& lv = market.localVolatility;
+            nodeSigma.resize(N + 1);
+            for (int j = 0; j <= N; j++) {
+                double sigma = 0.0;
+                for (int i = 0; i < static_cast<int>(lv.times.size()); i++) sigma = std::max(sigma, lv.at(i, nodes[j]));
+                nodeSigma[j] = sigma;
+            }
+            localRow = -1;
+        }
+        stepRate = rMin;
+        double limit = stabilityLimit();
+        stepRate = rMax;
+        limit = std::min(limit, stabilityLimit());
+        stepRate = params.r;
+        stepSigma = params.sigma;
+        return limit;
+    }
+
+    double nodeVolatility(int j) const {
+        return localVol ? nodeSigma[j] : stepSigma;
+    }
+
+    // Place les noeuds de la grille. Grille resserrée : S = K + c*sinh(x), x variant linéairement de asinh(-K/c) à asinh((Smax-K)/c).
+    // La largeur c est ajustée (par dichotomie, la fraction des noeuds sous K étant monotone en c) pour que le strike, point anguleux du payoff,
+    // soit exactement un noeud : le pas varie alors régulièrement et le schéma reste d'ordre 2. Il vaut environ c*dx près de K et croît avec |S - K|.
+    void buildNodes() {
+        nodes.resize(N + 1);
+        if (spacing == Spacing::Uniform) {
+            stretch = 0.0;
+            for (int j = 0; j <= N; j++) nodes[j] = j * dS;
+            return;
+        }
+        const double K = params.K;
+        auto nodesBelowK = [&](double c) { // Position de K dans la grille, en nombre de pas
+            const double x0 = std::asinh(K / c);
+            return N * x0 / (x0 + std::asinh((Smax - K) / c));
+        };
+        double c = stretchWidth * K + 0.5 * std::abs(params.S0 - K); // La zone resserrée contient aussi S0
+        const double jK = std::min(std::max(std::round(nodesBelowK(c)), 1.0), N - 1.0);
+        double lo = 1e-3 * c, hi = 1e3 * c; // nodesBelowK va de N/2 à N*K/Smax quand c augmente (décroît si Smax > 2K, croît pour une barrière proche de K)
+        const bool decreasing = 2.0 * K < Smax;
+        for (int it = 0; it < 100 && hi - lo > 1e-14 * hi; it++) {
+            const double mid = 0.5 * (lo + hi);
+            ((nodesBelowK(mid) > jK) == decreasing ? lo : hi) = mid;
+        }
+        stretch = c = 0.5 * (lo + hi);
+        const double x0 = -std::asinh(K / c), x1 = std::asinh((Smax - K) / c);
+        for (int j = 0; j <= N; j++) {
+            nodes[j] = K + c * std::sinh(x0 + (x1 - x0) * j / N);
+        }
+        nodes[0] = 0.0;
+        nodes[static_cast<int>(jK)] = K;
+        nodes[N] = Smax;
+    }
+
+    // Poids des dérivées première (d) et seconde (g) à trois points au noeud j : f'(S_j) = d[0]*f_{j-1} + d[1]*f_j + d[2]*f_{j+1}
+    void derivativeWeights(int j, double* d, double* g) const {
+        const double hm = nodes[j] - nodes[j - 1], hp = nodes[j + 1] - nodes[j];
+        d[0] = -hp / (hm * (hm + hp));
+        d[2] = hm / (hp * (hm + hp));
+        d[1] = -(d[0] + d[2]);
+        g[0] = 2.0 / (hm * (hm + hp));
+        g[2] = 2.0 / (hp * (hm + hp));
+        g[1] = -(g[0] + g[2]);
+    }
+
+    // Poids de Lagrange du polynôme de degré 3 passant par les noeuds j-1, j, j+1, j+2 (1 <= j <= N-2), évalué en S :
+    // f(S) = sum_i v[i]*f_{j-1+i}, et de même f'(S) avec d et f''(S) avec g
+    void cubicWeights(int j, double S, double* v, double* d, double* g) const {
+        const double* x = nodes.data() + j - 1;
+        for (int i = 0; i < 4; i++) {
+            double denom = 1.0, t[3];
+            for (int k = 0, n = 0; k < 4; k++) {
+                if (k == i) continue;
+                denom *= x[i] - x[k];
+                t[n++] = S - x[k];
+            }
+            v[i] = t[0] * t[1] * t[2] / denom;
+            d[i] = (t[0] * t[1] + t[0] * t[2] + t[1] * t[2]) / denom;
+            g[i] = 2.0 * (t[0] + t[1] + t[2]) / denom;
+        }
+    }
+
+    bool cubicRead(int j0) const { // Lecture cubique possible dans l'intervalle [S_j0, S_j0+1] (il faut un noeud de chaque côté)
+        return interpolation == Interpolation::Cubic && j0 >= 1 && j0 + 2 <= N;
+    }
+
+    // Coefficients de dt*L au noeud j (L : opérateur de Black-Scholes, pour stepRate, sigma(S_j) et la tendance r - q) : dt*L U_j = lo*U_{j-1} + (centre - r*dt)*U_j + up*U_{j+1}
+    void operatorRow(int j, double& lo, double& centre, double& up) const {
+        const double S = nodes[j];
+        if (spacing == Spacing::Uniform) {
+            const double sigma = nodeVolatility(j);
+            double alpha = (sigma * sigma * S * S * dt) / (2.0 * dS * dS);
+            double beta = ((stepRate - params.q) * S * dt) / (2.0 * dS);
+            lo = alpha - beta;
+            centre = -2.0 * alpha;
+            up = alpha + beta;
+            return;
+        }
+        double d[3], g[3];
+        derivativeWeights(j, d, g);
+        const double sigma = nodeVolatility(j);
+        const double diffusion = 0.5 * sigma * sigma * S * S * dt;
+        const double drift = (stepRate - params.q) * S * dt;
+        lo = diffusion * g[0] + drift * d[0];
+        centre = diffusion * g[1] + drift * d[1];
+        up = diffusion * g[2] + drift * d[2];
+    }
+
+    void computeOptionPrice() {
+        // Nous faisons le choix d'opter pour deux vecteurs (U et U_old) qui alternent leur rôle à chaque pas. Nous aurions pu créer une matrice qui garderait l'historique des prix.
+        // Ce choix rend l'implémentation plus légère, mais ne permet pas de conserver l'historique des prix complets.
+        solution.valid = false;
+        U.resize(N + 1); // Les deux buffers ne sont réalloués que si N augmente
+        U_old.resize(N + 1);
+        selectContract();
+        EDP_PHASE(Backward);
+        (this->*backward)();
+#ifdef EDP_INSTRUMENTATION
+        instrumentation.stats.timeSteps += M;
+        instrumentation.stats.nodeUpdates += static_cast<long long>(M) * (N - 1);
+        instrumentation.stats.solves++;
+#endif
+    }
+
+    template <class C>
+    double averagedPayoff(int j) const { // Moyenne du payoff sur la maille [milieu (j-1, j), milieu (j, j+1)] : l'erreur ne dépend plus de la position de K
+        const double a = j > 0 ? 0.5 * (nodes[j - 1] + nodes[j]) : nodes[0];
+        const double b = j < N ? 0.5 * (nodes[j] + nodes[j + 1]) : nodes[N];
+        return C::averaged(a, b, params.K);
+    }
+
+    template <class C>
+    void solveContract() {
+        for (int j = 0; j < N; j++) {
+            U[j] = smoothPayoff ? averagedPayoff<C>(j) : C::payoff(nodes[j], params.K); // Conditions limites (à maturité) : le prix de l'option est donc la plus value
+        }
+        U[N] = C::upperSpot(Smax) + C::upperCash(params.K); // Condition limite en Smax prise à tau = 0 (nulle sur une barrière)
+        if (earlyExercise) {
+            intrinsic.resize(N + 1);
+            for (int j = 0; j < N; j++) intrinsic[j] = C::payoff(nodes[j], params.K);
+            intrinsic[N] = U[N];
+            scheduleExercise();
+        }
+        solveBackward<C>();
+    }
+
+    // Remonte le temps de t=T à t=0 à partir du payoff contenu dans U, sans allocation.
+    // À chaque pas le nouveau prix est écrit dans U_old puis les deux buffers sont échangés (simple échange de pointeurs) :
+    // à la fin U contient la grille à t=0 et U_old celle à t=dt.
+    template <class C>
+    void solveBackward() {
+        if (timeDependent) prepareCurves();
+        else buildCoefficients();
+        if (cashDividends) scheduleDividends();
+        scheduleSnapshots();
+        const bool keepLevels = !keptLevel.empty(); // Les niveaux gardés passent tous par U : remontée générale, pas à pas, sur un thread
+        if (recording) {
+            solveBackwardRecorded<C>();
+            return;
+        }
+        if (precision != Precision::Double && !earlyExercise && !timeDependent && !cashDividends && !keepLevels) {
+            solveBackwardSingle<C>();
+            return;
+        }
+        const int team = keepLevels ? 1 : sweepTeam();
+        if (team == 1 && !earlyExercise && !timeDependent && !cashDividends && !keepLevels && solveBackwardPreset<C>()) return;
+        if (scheme == Scheme::Explicit) {
+            if (team > 1) {
+                solveBackwardParallel<C>(team);
+                return;
+            }
+            // La projection de l'exercice anticipé, les changements de coefficients et les sauts portent sur des niveaux entiers
+            if (temporalBlocking && N >= tiledMinN && !earlyExercise && !timeDependent && !cashDividends && !keepLevels) {
+                solveBackwardTiled<C>();
+                return;
+            }
+            for (int m = M; m > 0; m--) {
+                if (timeDependent) updateCoefficients(m);
+                explicitStep<C>(U.data(), U_old.data(), m);
+                U.swap(U_old);
+                if (cashDividends) applyDividends(m - 1);
+                if (keepLevels) keepLevel(m - 1);
+            }
+            return;
+        }
+
+        if (team > 1) {
+            solveBackwardPartitioned<C>(team);
+            return;
+        }
+        const double theta = scheme == Scheme::Implicit ? 1.0 : 0.5;
+        const bool rannacher = theta < 1.0;
+        int startSteps = rannacher ? rannacherSteps : 0; // Pas implicites de démarrage restants (payoff, puis après chaque saut de dividende)
+        for (int m = M; m > 0; m--) {
+            if (timeDependent) updateCoefficients(m);
+            const bool start = startSteps > 0;
+            thetaStep<C>(U.data(), U_old.data(), m, start ? 1.0 : theta, start ? startSolver : solver);
+            U.swap(U_old);
+            if (start) startSteps--;
+            if (cashDividends && applyDividends(m - 1) && rannacher) startSteps = rannacherSteps; // Le saut crée un nouveau coude
+            if (keepLevels) keepLevel(m - 1);
+        }
+    }
+
+    // Grilles prédéfinies : N = 100 (modes Rapide et Extrapolé), 500 (Resserré) et 2000 (Précis) ont chacune leur instance de la remontée,
+    // de taille fixe. Les autres N (mode Personnalisé, grilles de l'extrapolation et du mode tolérance) gardent la remontée générale.
+    template <class C>
+    bool solveBackwardPreset() {
+        switch (N) {
+        case 100: solveBackwardFixed<C, 100>(); return true;
+        case 500: solveBackwardFixed<C, 500>(); return true;
+        case 2000: solveBackwardFixed<C, 2000>(); return true;
+        default: return false;
+        }
+    }
+
+    template <int FixedN>
+    FixedStencilKernel fixedStencil() const { // Noyau de taille fixe du jeu d'instructions choisi par selectKernel
+        switch (kernel) {
+#ifdef EDP_X86_KERNELS
+        case Kernel::AVX512: return stencilAvx512Fixed<FixedN>;
+        case Kernel::AVX2: return stencilAvx2Fixed<FixedN>;
+#endif
+#ifdef EDP_NEON_KERNELS
+        case Kernel::NEON: return stencilNeonFixed<FixedN>;
+#endif
+        default: return stencilScalarFixed<FixedN>;
+        }
+    }
+
+    // Remontée de solveBackward (exercice européen, coefficients constants, un seul thread) pour N = FixedN : bornes des boucles et
+    // nombre de lignes de la substitution connus à la compilation, sur les buffers du pricer (ni copie ni tableau sur la pile).
+    // Les opérations sont celles des pas explicitStep et thetaStep, dans le même ordre : le résultat est identique bit à bit.
+    template <class C, int FixedN>
+    void solveBackwardFixed() {
+        const FixedStencilKernel fixed = fixedStencil<FixedN>();
+        const double* a = coef.a.data();
+        const double* b = coef.b.data();
+        const double* c = coef.c.data();
+        double* in = U.data();
+        double* out = U_old.data();
+        if (scheme == Scheme::Explicit) {
+            for (int m = M; m > 0; m--) {
+                fixed(a, b, c, in, out);
+                out[0] = lowerBoundary<C>(in[0], m);
+                out[FixedN] = upperBoundary<C>(m);
+                std::swap(in, out);
+            }
+        } else {
+            const double theta = schemeTheta();
+            int startSteps = theta < 1.0 ? rannacherSteps : 0;
+            for (int m = M; m > 0; m--) {
+                const bool start = startSteps > 0;
+                const double th = start ? 1.0 : theta;
+                const ThomasSolver& s = start ? startSolver : solver;
+                if (start) std::copy(in + 1, in + FixedN, out + 1);
+                else fixed(a, b, c, in, out);
+                out[0] = lowerBoundary<C>(in[0], m);
+                out[FixedN] = upperBoundary<C>(m);
+                out[1] += th * coef.lowerCoupling * out[0];
+                out[FixedN - 1] += th * coef.upperCoupling * out[FixedN];
+                ThomasSolver::substitute(s.lower.data(), s.cprime.data(), s.inv_m.data(), s.reversed, FixedN - 1, out + 1);
+                std::swap(in, out);
+                if (start) startSteps--;
+            }
+        }
+        if (M % 2 == 1) U.swap(U_old); // Le niveau t=0 doit se trouver dans U
+    }
+
+    // Remontée en simple précision ou en précision mixte, sur un seul thread et sans tuiles. Le schéma est celui de solveBackward écrit
+    // sous forme d'incrément : U^{m-1} = U^m + dt*L U^m pour le schéma explicite, et (I - th*dt*L) (U^{m-1} - U^m) = dt*L U^m pour les
+    // schémas theta, dont la substitution ne porte ainsi que sur l'incrément. Les coefficients sont arrondis une fois en float.
+    template <class C>
+    void solveBackwardSingle() {
+        for (AlignedFloatVector* v : {&single.a, &single.c, &single.e}) v->resize(N + 1);
+        for (int j = 1; j < N; j++) {
+            double lo, centre, up;
+            operatorRow(j, lo, centre, up);
+            single.a[j] = static_cast<float>(lo);
+            single.c[j] = static_cast<float>(up);
+            single.e[j] = static_cast<float>((centre + (lo + up)) - stepRate * dt); // -r*dt : les poids de L sont de somme nulle
+        }
+        if (scheme != Scheme::Explicit) {
+            single.solver.assign(solver);
+            if (scheme == Scheme::CrankNicolson) single.startSolver.assign(startSolver);
+        }
+        double edges[4]; // U_0 et U_N à t=0, puis à t=dt
+        if (precision == Precision::Mixed) {
+            sweepSingle<C>(U, U_old, mixedIncrement, edges);
+            return;
+        }
+        single.U.assign(U.begin(), U.end());
+        single.U_old.resize(N + 1);
+#ifdef EDP_X86_KERNELS
+        const unsigned int csr = _mm_getcsr();
+        _mm_setcsr(csr | 0x8040); // Sous-normaux remplacés par 0 (FTZ et DAZ) : sous 1e-38, loin de la monnaie, ils ralentiraient chaque opération
+#endif
+        sweepSingle<C>(single.U, single.U_old, floatIncrement, edges);
+#ifdef EDP_X86_KERNELS
+        _mm_setcsr(csr);
+#endif
+        std::copy(single.U.begin(), single.U.end(), U.begin()); // Lecture en S0 en double, bords compris
+        std::copy(single.U_old.begin(), single.U_old.end(), U_old.begin());
+        U[0] = edges[0];
+        U[N] = edges[1];
+        U_old[0] = edges[2];
+        U_old[N] = edges[3];
+    }
+
+    template <class C, class Vector, class Real>
+    void sweepSingle(Vector& u, Vector& uOld, IncrementKernel<Real> increment, double* edges) {
+        const float* a = single.a.data();
+        const float* c = single.c.data();
+        const float* e = single.e.data();
+        double low = U[0], high = U[N], lowPrev = low, highPrev = high; // Bords en double : le float n'arrondit que leur copie dans u
+        int startSteps = scheme == Scheme::CrankNicolson ? rannacherSteps : 0;
+        for (int m = M; m > 0; m--) {
+            lowPrev = low;
+            highPrev = high;
+            low = lowerBoundary<C>(low, m);
+            high = upperBoundary<C>(m);
+            const Real* in = u.data();
+            Real* out = uOld.data();
+            if (scheme == Scheme::Explicit) {
+                increment(a, c, e, in, out, 1, N, Real(1));
+            } else {
+                const bool start = startSteps > 0;
+                const double th = start ? 1.0 : schemeTheta();
+                increment(a, c, e, in, out, 1, N, Real(0));
+                out[1] += static_cast<Real>(th * coef.lowerCoupling * (low - lowPrev)); // Incréments des bords au nouveau temps
+                out[N - 1] += static_cast<Real>(th * coef.upperCoupling * (high - highPrev));
+                (start ? single.startSolver : single.solver).solveAdded(out + 1, in + 1);
+                if (start) startSteps--;
+            }
+            out[0] = static_cast<Real>(low);
+            out[N] = static_cast<Real>(high);
+            u.swap(uOld);
+        }
+        edges[0] = low;
+        edges[1] = high;
+        edges[2] = lowPrev;
+        edges[3] = highPrev;
+    }
+
+    // Pas de temps m (de U^m vers U^{m-1}) du schéma courant, Rannacher compris
+    double stepTheta(int m) const {
+        const double theta = schemeTheta();
+        return (scheme == Scheme::CrankNicolson && m > M - rannacherSteps) ? 1.0 : theta;
+    }
+    template <class C>
+    void stepContract(const double* in, double* out, int m) const {
+        if (scheme == Scheme::Explicit) {
+            explicitStep<C>(in, out, m);
+        } else {
+            const double th = stepTheta(m);
+            thetaStep<C>(in, out, m, th, th == schemeTheta() ? solver : startSolver);
+        }
+    }
+    void step(const double* in, double* out, int m) const {
+        (this->*stepper)(in, out, m);
+    }
+
+    // Passe avant qui enregistre les points de reprise de la passe adjointe (sans découpage par tuiles)
+    template <class C>
+    void solveBackwardRecorded() {
+        tapeStride = tapeStrideFor(M, N);
+        tape.resize(static_cast<std::size_t>((M + tapeStride - 1) / tapeStride) * (N + 1));
+        for (int m = M; m > 0; m--) {
+            if ((M - m) % tapeStride == 0) std::copy(U.begin(), U.end(), tape.begin() + static_cast<std::ptrdiff_t>((M - m) / tapeStride) * (N + 1));
+            stepContract<C>(U.data(), U_old.data(), m);
+            U.swap(U_old);
+            keepLevel(m - 1);
+        }
+    }
+
+    // Vega et Rho par différentiation adjointe (mode inverse) du schéma discret, grille figée : une seule passe adjointe
+    // donne toutes les sensibilités, pour un coût de l'ordre de deux à trois résolutions quel que soit leur nombre.
+    // Chaque pas s'écrit (I - th*G) U^{m-1} = (I + (1-th)*G) U^m + conditions aux limites, G étant le stencil de Black-Scholes
+    // (th = 0 pour le schéma explicite). L'adjoint résout le système transposé puis accumule rhsBar . dG/dp . ((1-th)*U^m + th*U^{m-1}).
+    // dV/dK vient de l'homogénéité du prix en (S, K) : h*V = S*Delta + K*dV/dK (h = 1 pour un call ou un put, 0 pour une option digitale ;
+    // NaN pour une barrière, qui ne change pas avec K). dV/dT = -Theta (seul T - t intervient).
+    void computeSensitivities(Result& res) {
+        EDP_PHASE(Sensitivities);
+        const int n = N + 1;
+        lambda.assign(n, 0.0);
+        lambdaNext.assign(n, 0.0);
+        rhsBar.assign(n, 0.0);
+
+        // Adjoint du prix interpolé en S0
+        int j0;
+        double w;
+        locate(params.S0, j0, w);
+        if (cubicRead(j0)) { // Mêmes poids que la lecture du prix
+            double v[4], d[4], g[4];
+            cubicWeights(j0, params.S0, v, d, g);
+            for (int i = 0; i < 4; i++) lambda[j0 - 1 + i] = v[i];
+        } else if (j0 < N) {
+            lambda[j0] = 1.0 - w;
+            lambda[j0 + 1] = w;
+        } else {
+            lambda[N] = 1.0;
+        }
+
+        sigmaLo.resize(n);
+        sigmaHi.resize(n);
+        rateLo.resize(n);
+        rateHi.resize(n);
+        for (int j = 1; j < N; j++) { // Les coefficients centraux s'en déduisent : -(lo + hi), et -dt pour r
+            const double S = nodes[j];
+            double d[3], g[3];
+            derivativeWeights(j, d, g);
+            sigmaLo[j] = params.sigma * S * S * dt * g[0];
+            sigmaHi[j] = params.sigma * S * S * dt * g[2];
+            rateLo[j] = S * dt * d[0];
+            rateHi[j] = S * dt * d[2];
+        }
+        if (!adjointValid) {
+            adjointA.assign(n, 0.0);
+            adjointC.assign(n, 0.0);
+            for (int i = 2; i < N; i++) adjointA[i] = coef.c[i - 1];
+            for (int i = 1; i + 1 < N; i++) adjointC[i] = coef.a[i + 1];
+            if (scheme != Scheme::Explicit) factorizeTheta(schemeTheta(), adjointSolver, true);
+            if (scheme == Scheme::CrankNicolson) factorizeTheta(1.0, adjointStartSolver, true);
+            adjointValid = true;
+        }
+
+        double dSigma = 0.0, dRate = 0.0;
+        levels.resize(tapeStride + 1);
+        segment.resize(static_cast<std::size_t>(std::max(tapeStride - 1, 1)) * n);
+        const int segments = (M + tapeStride - 1) / tapeStride;
+        for (int k = segments - 1; k >= 0; k--) { // Segments du plus proche de t=0 au plus proche de T
+            const int mHi = M - k * tapeStride;
+            const int mLo = std::max(0, mHi - tapeStride);
+            levels[0] = tape.data() + static_cast<std::size_t>(k) * n;
+            for (int m = mHi; m > mLo + 1; m--) { // Recalcul des niveaux intermédiaires
+                double* out = segment.data() + static_cast<std::size_t>(mHi - m) * n;
+                step(levels[mHi - m], out, m);
+                levels[mHi - m + 1] = out;
+            }
+            levels[mHi - mLo] = mLo == 0 ? U.data() : tape.data() + static_cast<std::size_t>(k + 1) * n;
+
+            for (int m = mLo + 1; m <= mHi; m++) {
+                adjointStep(levels[mHi - m], levels[mHi - m + 1], m, dSigma, dRate);
+            }
+        }
+
+        res.vega = dSigma;
+        res.rho = dRate;
+        res.dStrike = homogeneity >= 0 ? (homogeneity * res.price - params.S0 * res.delta) / params.K : std::numeric_limits<double>::quiet_NaN();
+        res.dMaturity = -res.theta;
+    }
+
+    // Pas adjoint m : lambda (adjoint de U^{m-1}) devient l'adjoint de U^m, en accumulant les dérivées par rapport à sigma et r
+    void adjointStep(const double* Um, const double* Um1, int m, double& dSigma, double& dRate) {
+        const double th = stepTheta(m);
+        double* rb = lambda.data(); // Schéma explicite : l'adjoint du second membre est lambda lui-même, sans copie
+        if (th > 0.0) {
+            rb = rhsBar.data();
+            for (int j = 1; j < N; j++) rb[j] = lambda[j];
+            (th == schemeTheta() ? adjointSolver : adjointStartSolver).solve(rb + 1);
+        }
+
+        // Conditions limites U^{m-1}_0 = lowerCash*exp(-r*tau) et U^{m-1}_N = spot + upperCash*exp(-r*tau) (Smax - K*exp(-r*tau) pour un call),
+        // reportées dans les lignes 1 et N-1 par les schémas implicites
+        const double tau = params.T - (m - 1) * dt;
+        const double lambda0 = lambda[0] + th * coef.lowerCoupling * rb[1];
+        const double lambdaN = lambda[N] + th * coef.upperCoupling * rb[N - 1];
+        dRate -= tau * std::exp(-params.r * tau) * (lambda0 * lowerCash + lambdaN * upperCash);
+
+        // Dérivées des coefficients : dG/dsigma = (sLo, -(sLo + sHi), sHi), dG/dr = (rLo, -(rLo + rHi), rHi) - dt * (0, 1, 0)
+        double sums[2] = {0.0, 0.0};
+        adjointKernel(rb, sigmaLo.data(), sigmaHi.data(), rateLo.data(), rateHi.data(), Um, th == 0.0 ? Um : Um1, th, dt, 1, N, sums); // Schéma explicite : U^{m-1} n'intervient pas
+        dSigma += sums[0];
+        dRate += sums[1];
+
+        // Transposée du second membre (I + (1-th)*G) : c'est encore un stencil à trois points, de coefficients (c[i-1], b[i], a[i+1]),
+        // calculé par le même noyau vectoriel. Identité pour les pas de Rannacher.
+        rb[0] = 0.0;
+        rb[N] = 0.0;
+        if (th == schemeTheta()) {
+            stencil(adjointA.data(), coef.b.data(), adjointC.data(), rb, lambdaNext.data(), 1, N);
+            lambdaNext[0] = coef.a[1] * rb[1];
+            lambdaNext[N] = coef.c[N - 1] * rb[N - 1];
+            lambda.swap(lambdaNext);
+        } else {
+            std::copy(rhsBar.begin(), rhsBar.end(), lambda.begin());
+        }
+    }
+
+    // Variante du schéma explicite par tuiles décalées dans le temps (parallélogrammes) : chaque tuile avance de tileSteps niveaux,
+    // sa plage de noeuds reculant d'un noeud par niveau pour ne dépendre que de valeurs déjà calculées.
+    // Avec deux buffers seulement, le niveau t écrase le niveau t-2 uniquement là où il n'est plus lu par la tuile suivante.
+    // Chaque noeud est calculé par le même noyau avec les mêmes opérandes que le parcours naïf : le résultat est identique bit à bit.
+    template <class C>
+    void solveBackwardTiled() {
+        const double* a = coef.a.data();
+        const double* b = coef.b.data();
+        const double* c = coef.c.data();
+        for (int mStart = M; mStart > 0; mStart -= tileSteps) {
+            const int levels = std::min(tileSteps, mStart);
+            for (int lo = 1; lo - (levels - 1) <= N; lo += tileWidth) {
+                const int hi = lo + tileWidth;
+                for (int t = 1; t <= levels; t++) {
+                    const double* in = (t % 2 == 1) ? U.data() : U_old.data();
+                    double* out = (t % 2 == 1) ? U_old.data() : U.data();
+                    const int begin = std::max(1, lo - (t - 1));
+                    const int end = std::min(N, hi - (t - 1));
+                    if (begin < end) stencil(a, b, c, in, out, begin, end);
+                    if (lo == 1) out[0] = lowerBoundary<C>(in[0], mStart - (t - 1)); // Condition limite en S=0, portée par la première tuile
+                    if (lo - (t - 1) <= N && N < hi - (t - 1)) out[N] = upperBoundary<C>(mStart - (t - 1)); // Condition limite en Smax, portée par la tuile qui contient N
+                }
+            }
+            if (levels % 2 == 1) U.swap(U_old); // Le dernier niveau calculé doit se trouver dans U
+        }
+    }
+
+    // Schéma explicite sur team threads : le thread k possède les noeuds [chunkBegin(k), chunkBegin(k+1)) et les avance de haloSteps
+    // pas sur une copie locale élargie de haloSteps noeuds de chaque côté, la plage calculée se rétrécissant d'un noeud par pas
+    // (les noeuds du halo sont recalculés par les deux voisins). Seule la plage possédée est recopiée dans le buffer partagé,
+    // suivie d'une barrière : une synchronisation tous les haloSteps pas. Les noeuds sont identiques bit à bit au parcours séquentiel.
+    template <class C>
+    void solveBackwardParallel(int team) {
+        const double* a = coef.a.data();
+        const double* b = coef.b.data();
+        const double* c = coef.c.data();
+        if (haloCopies.size() < 2 * static_cast<std::size_t>(team)) haloCopies.resize(2 * team);
+        SpinBarrier barrier(team);
+        auto worker = [&](int k) {
+            const int lo = chunkBegin(k, team), hi = chunkBegin(k + 1, team);
+            const int base = std::max(0, lo - haloSteps), top = std::min(N, hi + haloSteps); // Copie locale des noeuds base..top
+            AlignedVector& x = haloCopies[2 * k];
+            AlignedVector& y = haloCopies[2 * k + 1];
+            x.resize(top - base + 1);
+            y.resize(top - base + 1);
+            double* shared[2] = {U.data(), U_old.data()};
+            int source = 0;
+            double* previous = nullptr; // Niveau t=dt, recopié à la fin dans le second buffer pour Theta
+            for (int mStart = M; mStart > 0; mStart -= haloSteps) {
+                const int levels = std::min(haloSteps, mStart);
+                std::copy(shared[source] + base, shared[source] + top + 1, x.begin());
+                double* in = x.data();
+                double* out = y.data();
+                for (int t = 1; t <= levels; t++) {
+                    const int reach = levels - t; // Noeuds du halo encore utiles aux pas suivants
+                    const int begin = std::max(1, lo - reach), end = std::min(N, hi + reach);
+                    const int m = mStart - (t - 1);
+                    stencil(a + base, b + base, c + base, in, out, begin - base, end - base);
+                    if (begin == 1) out[0] = lowerBoundary<C>(in[0], m); // base = 0 dans ce cas
+                    if (end == N) out[N - base] = upperBoundary<C>(m); // top = N dans ce cas
+                    std::swap(in, out);
+                }
+                double* target = shared[1 - source];
+                std::copy(in + (lo - base), in + (hi - base), target + lo);
+                if (k == 0) target[0] = in[0];
+                if (k == team - 1) target[N] = in[N - base];
+                previous = out;
+                barrier.wait(); // Toutes les copies du bloc sont terminées avant que le bloc suivant n'écrase l'autre buffer
+                source = 1 - source;
+            }
+            double* target = shared[1 - source]; // Plus lu par personne après la dernière barrière
+            std::copy(previous + (lo - base), previous + (hi - base), target + lo);
+            if (k == 0) target[0] = previous[0];
+            if (k == team - 1) target[N] = previous[N - base];
+        };
+        std::vector<std::thread> threads;
+        for (int k = 1; k < team; k++) threads.emplace_back(worker, k);
+        worker(0);
+        for (std::thread& t : threads) t.join();
+        const int blocks = (M + haloSteps - 1) / haloSteps;
+        if (blocks % 2 == 1) U.swap(U_old); // Le niveau t=0 doit se trouver dans U
+    }
+
+    // Factorise le bloc k (noeuds lo..hi-1) de (I - th*dt*L) et calcule ses pointes
+    void factorBlock(double th, PartitionedSolver& ps, int k, int team, int lo, int hi) const {
+        ThomasSolver& s = ps.blocks[k];
+        const int n = hi - lo;
+        s.resize(n);
+        s.reversed = false;
+        double lower = 0.0, upper = 0.0; // Couplages avec les blocs voisins
+        for (int i = 0; i < n; i++) {
+            double l, centre, u;
+            operatorRow(lo + i, l, centre, u);
+            s.inv_m[i] = 1.0 + th * (stepRate * dt - centre);
+            s.lower[i] = -th * l;
+            s.cprime[i] = -th * u;
+            if (i == 0) lower = -th * l;
+            if (i == n - 1) upper = -th * u;
+        }
+        s.factorize();
+        double* v = ps.v.data() + lo;
+        double* w = ps.w.data() + lo;
+        std::fill(v, v + n, 0.0);
+        std::fill(w, w + n, 0.0);
+        if (k > 0) { // Le premier bloc est couplé à S=0, déjà passé dans le second membre
+            v[0] = lower;
+            s.solve(v);
+        }
+        if (k < team - 1) {
+            w[n - 1] = upper;
+            s.solve(w);
+        }
+        double* e = &ps.spikeEnds[4 * k];
+        e[0] = v[0];
+        e[1] = w[0];
+        e[2] = v[n - 1];
+        e[3] = w[n - 1];
+    }
+
+    // Schémas theta sur team threads : second membre, solution locale de chaque bloc, barrière, système réduit (résolu par chaque thread),
+    // correction par les pointes, barrière. Le résultat ne diffère du solveur de Thomas séquentiel que par les arrondis.
+    template <class C>
+    void solveBackwardPartitioned(int team) {
+        const double theta = schemeTheta();
+        const bool rannacher = theta < 1.0;
+        partition.resize(team, N + 1);
+        if (rannacher) startPartition.resize(team, N + 1);
+        const double* a = coef.a.data();
+        const double* b = coef.b.data();
+        const double* c = coef.c.data();
+        SpinBarrier barrier(team);
+        auto worker = [&](int k) {
+            const int lo = chunkBegin(k, team), hi = chunkBegin(k + 1, team);
+            factorBlock(theta, partition, k, team, lo, hi);
+            if (rannacher) factorBlock(1.0, startPartition, k, team, lo, hi);
+            barrier.wait();
+            if (k == 0) {
+                partition.reduce();
+                if (rannacher) startPartition.reduce();
+            }
+            barrier.wait();
+            double* interfaces = partition.interfaces.data() + PartitionedSolver::interfaceStride(team) * k; // Sert aussi aux pas de démarrage
+            double* in = U.data();
+            double* out = U_old.data();
+            for (int m = M; m > 0; m--) {
+                const double th = (rannacher && m > M - rannacherSteps) ? 1.0 : theta;
+                PartitionedSolver& ps = th == theta ? partition : startPartition;
+                if (th == theta) stencil(a, b, c, in, out, lo, hi);
+                else std::copy(in + lo, in + hi, out + lo);
+                if (k == 0) {
+                    out[0] = lowerBoundary<C>(in[0], m);
+                    out[1] += th * coef.lowerCoupling * out[0];
+                }
+                if (k == team - 1) {
+                    out[N] = upperBoundary<C>(m);
+                    out[N - 1] += th * coef.upperCoupling * out[N];
+                }
+                ps.blocks[k].solve(out + lo);
+                ps.ends[2 * k] = out[lo];
+                ps.ends[2 * k + 1] = out[hi - 1];
+                barrier.wait();
+                ps.solveInterfaces(interfaces);
+                const double xl = k > 0 ? interfaces[2 * (k - 1)] : 0.0;
+                const double xr = k < team - 1 ? interfaces[2 * k + 1] : 0.0;
+                const double* v = ps.v.data();
+                const double* w = ps.w.data();
+                for (int j = lo; j < hi; j++) out[j] -= v[j] * xl + w[j] * xr;
+                barrier.wait(); // Le pas suivant lit les noeuds voisins des autres blocs
+                std::swap(in, out);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (int k = 1; k < team; k++) threads.emplace_back(worker, k);
+        worker(0);
+        for (std::thread& t : threads) t.join();
+        if (M % 2 == 1) U.swap(U_old);
+    }
+
+    template <class C>
+    double upperBoundary(int m) const { // Condition limite en S=Smax au temps (m-1)*dt : U(Smax,t) = Smax*exp(-q*tau) - K*exp(-r*tau) pour un call
+        double tau = params.T - (m - 1) * dt; // Temps futur par rapport à la finalité
+        const double discount = timeDependent ? levelDiscount[m - 1] : std::exp(-params.r * tau);
+        const double spot = Smax * std::exp(-params.q * tau) - (cashDividends ? dividendValue[m - 1] : 0.0); // Valeur du sous-jacent sans ses dividendes
+        const double value = C::upperSpot(spot) + C::upperCash(params.K) * discount;
+        return earlyExercise && exerciseLevel[m - 1] ? std::max(value, intrinsic[N]) : value; // Un call avec dividendes peut valoir plus exercé
+    }
+
+    // Condition limite en S=0 au temps (m-1)*dt à partir de sa valeur in0 au temps m*dt : le sous-jacent y reste nul, l'option
+    // est un zéro-coupon de nominal lowerCash (0 pour un call, K pour un put), remboursable dès qu'elle peut être exercée
+    template <class C>
+    double lowerBoundary(double in0, int m) const {
+        const double value = in0 * coef.discount;
+        return earlyExercise && exerciseLevel[m - 1] ? std::max(value, intrinsic[0]) : value;
+    }
+
+    double schemeTheta() const { // Poids implicite du schéma (0 pour le schéma explicite)
+        return scheme == Scheme::Explicit ? 0.0 : (scheme == Scheme::Implicit ? 1.0 : 0.5);
+    }
+
+    // Résolution d'un contrat sur une grille de borne supérieure smax (payoff moyenné par maille si smoothed)
+    Result solve(const Parameters& p, const GridSettings& grid, double smax, bool smoothed) {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        if (!validParameters(p) || grid.N < 2 || barrierError(p, grid) || marketError(grid.market)) return {nan, nan, nan, nan};
+        interpolation = grid.interpolation;
+        if (solution.matches(p, grid, smax, smoothed, exerciseDates, market, snapshotTimes)) { // Même marché et même grille : seule la lecture en S0 est refaite
+            params = p;
+            Result res = computeResults();
+            if (grid.sensitivities && adjointAvailable()) computeSensitivities(res);
+            return res;
+        }
+        params = p;
+        Smax = smax;
+        scheme = grid.scheme;
+        spacing = grid.spacing;
+        if (grid.kernel != kernel) selectKernel(grid.kernel);
+        temporalBlocking = grid.temporalBlocking;
+        precision = grid.precision;
+        sweepThreads = grid.threads > 0 ? grid.threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        smoothPayoff = smoothed;
+        configureExercise(grid.exercise, grid.exerciseDates);
+        configureMarket(grid.market);
+        snapshotTimes = grid.snapshotTimes;
+        payoff = grid.payoff;
+        barrier = grid.barrier;
+        N = grid.N;
+        configureGrid(grid.M);
+        if (!checkStability()) return {nan, nan, nan, nan};
+        recording = grid.sensitivities && adjointAvailable();
+        computeOptionPrice();
+        recording = false;
+        solution = {true, p.K, p.r, p.sigma, p.T, p.q, smax, grid.N, grid.M, scheme, spacing, kernel, temporalBlocking, smoothed, grid.sensitivities,
+                    exercise, precision, payoff, p.type, barrier, 0.0, Smax};
+        if (spacing == Spacing::Stretched) {
+            solution.low = std::max(0.0, p.S0 - 0.5 * stretch);
+            solution.high = std::min(Smax, p.S0 + 0.5 * stretch);
+        } else {
+            solution.high = std::numeric_limits<double>::infinity();
+        }
+        Result res = computeResults();
+        if (grid.sensitivities && adjointAvailable()) computeSensitivities(res);
+        return res;
+    }
+
+    // Construit la table des coefficients (et les factorisations des schémas implicites) si la grille ou le marché ont changé
+    void buildCoefficients() {
+        if (coef.matches(N, dS, stretch, params.r, params.q, params.sigma, dt, scheme, exerciseBelow)) return;
+        fillCoefficients();
+        coef.valid = true;
+        coef.N = N;
+        coef.dS = dS;
+        coef.stretch = stretch;
+        coef.r = params.r;
+        coef.q = params.q;
+        coef.sigma = params.sigma;
+        coef.dt = dt;
+        coef.scheme = scheme;
+        coef.reversed = exerciseBelow;
+    }
+
+    // Courbes de marché : facteurs d'actualisation de chaque niveau (r pris au milieu de chaque pas, comme pour les coefficients)
+    void prepareCurves() {
+        levelDiscount.resize(M + 1);
+        levelDiscount[M] = 1.0;
+        for (int m = M; m > 0; m--) {
+            const double r = market.rate.empty() ? params.r : market.rate.at((m - 0.5) * dt);
+            levelDiscount[m - 1] = levelDiscount[m] * std::exp(-r * dt);
+        }
+        coefficientsReady = false;
+        coef.valid = false; // La table ne correspond plus à aucune clé de coefficients constants
+    }
+
+    // Coefficients du pas m (de t = m*dt à (m-1)*dt), avec r, sigma et la ligne de volatilité locale pris au milieu du pas.
+    // La table et les factorisations ne sont reconstruites que si l'une de ces valeurs diffère de celles déjà en place :
+    // un pas sans changement de courbe ne coûte que trois recherches dans les dates.
+    void updateCoefficients(int m) {
+        const double t = (m - 0.5) * dt;
+        const double r = market.rate.empty() ? params.r : market.rate.at(t);
+        const double sigma = market.volatility.empty() ? params.sigma : market.volatility.at(t);
+        bool changed = !coefficientsReady || r != stepRate || (!localVol && sigma != stepSigma);
+        if (localVol) {
+            const LocalVolatility& lv = market.localVolatility;
+            const int row = lv.interval(t);
+            if (row != localRow) {
+                if (localRow < 0 || !lv.sameRow(row, localRow)) {
+                    nodeSigma.resize(N + 1);
+                    for (int j = 0; j <= N; j++) nodeSigma[j] = lv.at(row, nodes[j]);
+                    changed = true;
+                }
+                localRow = row;
+            }
+        }
+        if (!changed) return;
+        stepRate = r;
+        stepSigma = sigma;
+        fillCoefficients();
+        coefficientsReady = true;
+    }
+
+    // Table des coefficients et factorisations pour stepRate et sigma(S_j)
+    void fillCoefficients() {
+        EDP_PHASE(Coefficients);
+        const double theta = schemeTheta();
+        coef.a.resize(N + 1);
+        coef.b.resize(N + 1);
+        coef.c.resize(N + 1);
+        for (int j = 1; j < N; j++) {
+            double lo, centre, up;
+            operatorRow(j, lo, centre, up);
+            if (scheme == Scheme::Explicit) {
+                coef.a[j] = lo;
+                coef.b[j] = 1.0 - stepRate * dt + centre;
+                coef.c[j] = up;
+            } else {
+                coef.a[j] = (1.0 - theta) * lo;
+                coef.b[j] = 1.0 - (1.0 - theta) * (stepRate * dt - centre);
+                coef.c[j] = (1.0 - theta) * up;
+            }
+            if (j == 1) coef.lowerCoupling = lo;
+            if (j == N - 1) coef.upperCoupling = up;
+        }
+        coef.discount = std::exp(-stepRate * dt);
+        if (scheme != Scheme::Explicit) {
+            factorizeTheta(theta, solver);
+            if (theta < 1.0) factorizeTheta(1.0, startSolver);
+        }
+        adjointValid = false;
+    }
+
+    // Pas explicite : calcule le prix au temps (m-1)*dt (out) à partir du prix au temps m*dt (in)
+    template <class C>
+    void explicitStep(const double* in, double* out, int m) const {
+        stencil(coef.a.data(), coef.b.data(), coef.c.data(), in, out, 1, N);  // Calcul du nouveau vecteur prix U par la formule de récurrence
+
+        // Conditions aux limites (t=0)
+        out[0] = lowerBoundary<C>(in[0], m); // j=0 : S=0, pour un call : U=0
+
+        // t=0, j=N : S=Smax, condition limite : U(Smax,t)
+        out[N] = upperBoundary<C>(m);
+
+        if (earlyExercise && exerciseLevel[m - 1]) project(out);
+    }
+
+    // Factorise la matrice (I - theta*dt*L) des noeuds intérieurs j=1..N-1 (ou sa transposée pour la passe adjointe)
+    void factorizeTheta(double theta, ThomasSolver& s, bool transposed = false) const {
+        const int n = N - 1;
+        s.resize(n); // Les diagonales sont écrites directement dans les buffers du solveur, puis factorisées en place
+        s.reversed = exerciseBelow && !transposed; // Brennan-Schwartz : la substitution d'un put part de S=0, côté exercice
+        for (int i = 0; i < n; i++) { // Ligne i : noeud j = i + 1
+            double lo, centre, up;
+            operatorRow(i + 1, lo, centre, up);
+            s.inv_m[i] = 1.0 + theta * (stepRate * dt - centre);
+            if (!transposed) {
+                s.lower[i] = -theta * lo;
+                s.cprime[i] = -theta * up;
+            } else { // Sous- et sur-diagonales échangées et décalées d'un rang
+                if (i + 1 < n) s.lower[i + 1] = -theta * up;
+                if (i > 0) s.cprime[i - 1] = -theta * lo;
+            }
+        }
+        if (transposed) {
+            s.lower[0] = 0.0;
+            s.cprime[n - 1] = 0.0;
+        }
+        s.factorize();
+    }
+
+    // Pas du schéma theta : (I - theta*dt*L) U^m = (I + (1-theta)*dt*L) U^{m+1}
+    // theta = 1 donne le schéma implicite, theta = 0.5 le schéma de Crank-Nicolson.
+    // Les pas de démarrage de Rannacher (th = 1 pour Crank-Nicolson) ont un second membre réduit à U^{m+1}.
+    // Aux dates d'exercice, le système devient un problème d'obstacle U >= valeur d'exercice, résolu par ThomasSolver::solveProjected.
+    template <class C>
+    void thetaStep(const double* in, double* out, int m, double th, const ThomasSolver& s) const {
+        if (th == schemeTheta()) {
+            stencil(coef.a.data(), coef.b.data(), coef.c.data(), in, out, 1, N); // Second membre : partie explicite du schéma
+        } else {
+            std::copy(in + 1, in + N, out + 1);
+        }
+
+        out[0] = lowerBoundary<C>(in[0], m);
+        out[N] = upperBoundary<C>(m);
+
+        // Les conditions aux limites au nouveau temps passent dans le second membre
+        out[1] += th * coef.lowerCoupling * out[0];
+        out[N - 1] += th * coef.upperCoupling * out[N];
+
+        if (earlyExercise && exerciseLevel[m - 1]) s.solveProjected(out + 1, intrinsic.data() + 1);
+        else s.solve(out + 1);
+    }
+
+    // À présent, U correspond à la grille au temps t=0.
+    // On récupère le prix pour S0. On doit interpoler si S0 n'est pas un point de grille exact.
+
+    void locate(double S, int& j0, double& w) const { // Intervalle [S_j0, S_j0+1] contenant S et poids d'interpolation (j0 = N au-delà de Smax)
+        if (spacing == Spacing::Uniform) {
+            double S_index = S / dS;
+            j0 = std::min(static_cast<int>(std::floor(S_index)), N);
+            w = S_index - j0;
+        } else {
+            j0 = static_cast<int>(std::upper_bound(nodes.begin(), nodes.end(), S) - nodes.begin()) - 1;
+            w = j0 < N ? (S - nodes[j0]) / (nodes[j0 + 1] - nodes[j0]) : 0.0;
+        }
+        if (j0 < N && w > 1.0 - 1e-9) { // S sur un noeud à l'arrondi près : Delta et Gamma sont lus en ce noeud
+            j0++;
+            w = 0.0;
+        }
+    }
+
+    Result computeResults() const {
+        return resultsAt(params.S0, 1.0);
+    }
+
+    // Lit le prix et les Grecques en S0, la grille calculée étant mise à l'échelle par scale
+    // (scale = 1 pour la grille du contrat, scale = K pour la grille normalisée d'une échelle de strikes).
+    // La grille porte directement le contrat (call, put, digitale ou barrière) : aucune parité n'est appliquée.
+    Result resultsAt(double S0, double scale) const {
+        EDP_PHASE(Results);
+        int j0;
+        double w;
+        locate(S0 / scale, j0, w); // S0 au-delà de Smax : on prend la valeur au bord
+        
+        double price, Delta = 0.0, Gamma = 0.0, theta_old, theta_new;
+        if (cubicRead(j0)) {
+            // Polynôme de degré 3 sur les noeuds j0-1..j0+2 : le prix, Delta et Gamma sont lus en S0 même et non au noeud j0
+            double v[4], d[4], g[4];
+            cubicWeights(j0, S0 / scale, v, d, g);
+            const double* u = U.data() + j0 - 1;
+            const double* o = U_old.data() + j0 - 1;
+            theta_new = v[0] * u[0] + v[1] * u[1] + v[2] * u[2] + v[3] * u[3];
+            theta_old = v[0] * o[0] + v[1] * o[1] + v[2] * o[2] + v[3] * o[3];
+            price = scale * theta_new;
+            Delta = d[0] * u[0] + d[1] * u[1] + d[2] * u[2] + d[3] * u[3];
+            Gamma = (g[0] * u[0] + g[1] * u[1] + g[2] * u[2] + g[3] * u[3]) / scale;
+        } else {
+            price = (j0 >= 0 && j0 < N) ? scale * ((1.0 - w) * U[j0] + w * U[j0 + 1]) : scale * U[j0];
+
+            // Calcul des Grecques (Delta et Gamma) par différences finies.
+            // On utilise les points j0-1, j0, j0+1, en vérifiant que j0>0 et j0<N :
+            if (j0 > 0 && j0 < N) {
+                double d[3], g[3]; // Différences centrées sur une grille uniforme
+                derivativeWeights(j0, d, g);
+                Delta = d[0] * U[j0 - 1] + d[1] * U[j0] + d[2] * U[j0 + 1];
+                Gamma = (g[0] * U[j0 - 1] + g[1] * U[j0] + g[2] * U[j0 + 1]) / scale;
+            }
+
+            // Theta à partir des deux derniers niveaux de temps conservés par le calcul : U_old contient la grille à t=dt
+            theta_old = (j0 >= 0 && j0 < N) ? (1.0 - w) * U_old[j0] + w * U_old[j0 + 1] : U_old[j0];
+            theta_new = (j0 >= 0 && j0 < N) ? (1.0 - w) * U[j0] + w * U[j0 + 1] : U[j0];
+        }
+        double Theta = scale * (theta_old - theta_new) / dt;
+
+        return {price, Delta, Gamma, Theta};
+    }
+
+    void displayResults() const {
+        const Result res = computeResults();
+        EDP_PHASE(Display);
+        displayResults(res);
+    }
+
+    static void displayResults(const Result& res) {
+        std::cout << "Prix de l'option : " << res.price << "\n";
+        std::cout << "Delta : " << res.delta << "\n";
+        std::cout << "Gamma : " << res.gamma << "\n";
+        std::cout << "Theta : " << res.theta << "\n";
+        if (!std::isnan(res.errorEstimate)) std::cout << "Erreur estimée : " << res.errorEstimate << "\n";
+    }
+};
+
+// Formule fermée de Black-Scholes : pour un call ou un put européen à r et sigma constants, elle donne directement
+// le prix et les Grecques, sans résoudre l'EDP. Les contrats sont traités par tableaux (un tableau par champ),
+// plusieurs à la fois dans les registres SIMD.
+// Avec w = +1 pour un call et -1 pour un put, et le taux de dividende continu q (formule de Merton) :
+//   d1 = (ln(S0/K) + (r - q + sigma^2/2) T) / (sigma sqrt(T)),  d2 = d1 - sigma sqrt(T)
+//   prix = w (S0 e^{-qT} N(w d1) - K e^{-rT} N(w d2)),  Delta = w e^{-qT} N(w d1),  Gamma = e^{-qT} n(d1) / (S0 sigma sqrt(T))
+// La fonction de répartition N est l'approximation rationnelle de Hart (algorithme 5666, sous la forme de West),
+// exacte au double près en absolu ; au-delà de |x| = 7.07 une fraction continue prend le relais, et N vaut 0 ou 1 au-delà de |x| = 37.
+// Les deux branches sont évaluées pour tout le vecteur puis sélectionnées par masque : aucun branchement par contrat.
+struct AnalyticBlock { // Tableaux d'entrée et de sortie d'un bloc de contrats
+    const double* type;
+    const double* S0;
+    const double* K;
+    const double* r;
+    const double* sigma;
+    const double* T;
+    const double* q;
+    double* price;
+    double* delta;
+    double* gamma;
+    double* theta;
+    double* vega;
+    double* rho;
+    double* dStrike;
+};
+
+typedef void (*AnalyticKernel)(const AnalyticBlock& b, int begin, int end);
+
+static const double hartNumerator[7] = {3.52624965998911e-02, 0.700383064443688, 6.37396220353165, 33.912866078383, 112.079291497871, 221.213596169931, 220.206867912376};
+static const double hartDenominator[8] = {8.83883476483184e-02, 1.75566716318264, 16.064177579207, 86.7807322029461, 296.564248779674, 637.333633378831, 793.826512519948, 440.413735824752};
+static const double hartSwitch = 7.07106781186547; // 10 / sqrt(2)
+static const double hartCutoff = 37.0;
+static const double sqrtTwoPi = 2.506628274631000502;
+// Fonctions élémentaires des versions vectorielles (les versions scalaires utilisent std::exp et std::log) :
+// exp(x) = 2^n e^t avec |t| <= ln(2)/2 (série de Taylor jusqu'au degré 12) ; ln(x) = e ln(2) + ln(m), m dans [sqrt(2)/2, sqrt(2)),
+// ln(m) = 2 atanh(s) avec s = (m-1)/(m+1) (série jusqu'à s^19). L'erreur relative reste de l'ordre de 1e-16.
+static const double expTaylor[13] = {1.0 / 479001600, 1.0 / 39916800, 1.0 / 3628800, 1.0 / 362880, 1.0 / 40320, 1.0 / 5040, 1.0 / 720, 1.0 / 120, 1.0 / 24, 1.0 / 6, 0.5, 1.0, 1.0};
+static const double atanhSeries[10] = {1.0 / 19, 1.0 / 17, 1.0 / 15, 1.0 / 13, 1.0 / 11, 1.0 / 9, 1.0 / 7, 1.0 / 5, 1.0 / 3, 1.0};
+static const double ln2Hi = 6.93147180369123816490e-01; // ln(2) en deux morceaux : n * ln2Hi est exact
+static const double ln2Lo = 1.90821492927058770002e-10;
+static const double expLimit = 708.0; // Au-delà, e^x sort des doubles normalisés
+
+static double normalCdfScalar(double x, double& gauss) { // Renvoie N(x) et gauss = exp(-x^2/2)
+    const double xa = std::fabs(x);
+    gauss = std::exp(-0.5 * xa * xa);
+    double num = hartNumerator[0], den = hartDenominator[0];
+    for (int i = 1; i < 7; i++) num = num * xa + hartNumerator[i];
+    for (int i = 1; i < 8; i++) den = den * xa + hartDenominator[i];
+    double fraction = xa + 0.65;
+    for (int k = 4; k >= 1; k--) fraction = xa + k / fraction;
+    double tail = xa < hartSwitch ? gauss * num / den : gauss / (fraction * sqrtTwoPi);
+    if (xa > hartCutoff) tail = 0.0;
+    return x > 0 ? 1.0 - tail : tail;
+}
+
+static void analyticScalar(const AnalyticBlock& b, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        const double w = 2.0 * b.type[i] - 1.0;
+        const double sqrtT = std::sqrt(b.T[i]);
+        const double vol = b.sigma[i] * sqrtT;
+        const double d1 = (std::log(b.S0[i] / b.K[i]) + (b.r[i] - b.q[i] + 0.5 * b.sigma[i] * b.sigma[i]) * b.T[i]) / vol;
+        const double discount = std::exp(-b.r[i] * b.T[i]);
+        const double carry = std::exp(-b.q[i] * b.T[i]);
+        const double spot = b.S0[i] * carry; // S0 e^{-qT}
+        double gauss, unused;
+        const double n1 = normalCdfScalar(w * d1, gauss);
+        const double n2 = normalCdfScalar(w * (d1 - vol), unused);
+        const double density = gauss / sqrtTwoPi;
+        const double strikePart = b.K[i] * discount * n2; // K e^{-rT} N(w d2)
+        b.price[i] = w * (spot * n1 - strikePart);
+        b.delta[i] = w * carry * n1;
+        b.gamma[i] = carry * density / (b.S0[i] * vol);
+        b.vega[i] = spot * density * sqrtT;
+        b.theta[i] = -0.5 * spot * density * b.sigma[i] / sqrtT - w * b.r[i] * strikePart + w * b.q[i] * spot * n1;
+        b.rho[i] = w * b.T[i] * strikePart;
+        b.dStrike[i] = -w * discount * n2;
+    }
+}
+
+#ifdef EDP_X86_KERNELS
+__attribute__((target("avx2,fma")))
+static inline __m256d expAvx2(__m256d x) {
+    x = _mm256_max_pd(_mm256_min_pd(x, _mm256_set1_pd(expLimit)), _mm256_set1_pd(-expLimit));
+    const __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.4426950408889634)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d t = _mm256_fnmadd_pd(n, _mm256_set1_pd(ln2Hi), x);
+    t = _mm256_fnmadd_pd(n, _mm256_set1_pd(ln2Lo), t);
+    __m256d p = _mm256_set1_pd(expTaylor[0]);
+    for (int i = 1; i < 13; i++) p = _mm256_fmadd_pd(p, t, _mm256_set1_pd(expTaylor[i]));
+    __m256i e = _mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n)), _mm256_set1_epi64x(1023));
+    return _mm256_mul_pd(p, _mm256_castsi256_pd(_mm256_slli_epi64(e, 52))); // 2^n construit directement dans le champ exposant
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256d logAvx2(__m256d x) { // x > 0 normalisé
+    const __m256i bits = _mm256_castpd_si256(x);
+    const __m256d twoPow52 = _mm256_castsi256_pd(_mm256_set1_epi64x(0x4330000000000000LL));
+    // Exposant biaisé converti en double en le plaçant dans la mantisse de 2^52
+    __m256d e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_castpd_si256(twoPow52))), twoPow52);
+    e = _mm256_sub_pd(e, _mm256_set1_pd(1023.0));
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)), _mm256_set1_epi64x(0x3FF0000000000000LL)));
+    const __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+    e = _mm256_add_pd(e, _mm256_and_pd(big, _mm256_set1_pd(1.0)));
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d s = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+    const __m256d z = _mm256_mul_pd(s, s);
+    __m256d p = _mm256_set1_pd(atanhSeries[0]);
+    for (int i = 1; i < 10; i++) p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(atanhSeries[i]));
+    const __m256d lnm = _mm256_mul_pd(_mm256_add_pd(s, s), p);
+    return _mm256_fmadd_pd(e, _mm256_set1_pd(ln2Hi), _mm256_fmadd_pd(e, _mm256_set1_pd(ln2Lo), lnm));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256d normalCdfAvx2(__m256d x, __m256d& gauss) {
+    const __m256d xa = _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+    gauss = expAvx2(_mm256_mul_pd(_mm256_set1_pd(-0.5), _mm256_mul_pd(xa, xa)));
+    __m256d num = _mm256_set1_pd(hartNumerator[0]), den = _mm256_set1_pd(hartDenominator[0]);
+    for (int i = 1; i < 7; i++) num = _mm256_fmadd_pd(num, xa, _mm256_set1_pd(hartNumerator[i]));
+    for (int i = 1; i < 8; i++) den = _mm256_fmadd_pd(den, xa, _mm256_set1_pd(hartDenominator[i]));
+    __m256d fraction = _mm256_add_pd(xa, _mm256_set1_pd(0.65));
+    for (int k = 4; k >= 1; k--) fraction = _mm256_add_pd(xa, _mm256_div_pd(_mm256_set1_pd(k), fraction));
+    const __m256d nearTail = _mm256_div_pd(_mm256_mul_pd(gauss, num), den);
+    const __m256d farTail = _mm256_div_pd(gauss, _mm256_mul_pd(fraction, _mm256_set1_pd(sqrtTwoPi)));
+    __m256d tail = _mm256_blendv_pd(nearTail, farTail, _mm256_cmp_pd(xa, _mm256_set1_pd(hartSwitch), _CMP_GE_OQ));
+    tail = _mm256_andnot_pd(_mm256_cmp_pd(xa, _mm256_set1_pd(hartCutoff), _CMP_GT_OQ), tail);
+    return _mm256_blendv_pd(tail, _mm256_sub_pd(_mm256_set1_pd(1.0), tail), _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_GT_OQ));
+}
+
+__attribute__((target("avx2,fma")))
+static void analyticAvx2(const AnalyticBlock& b, int begin, int end) {
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        const __m256d S = _mm256_loadu_pd(b.S0 + i), K = _mm256_loadu_pd(b.K + i), r = _mm256_loadu_pd(b.r + i);
+        const __m256d sigma = _mm256_loadu_pd(b.sigma + i), T = _mm256_loadu_pd(b.T + i), q = _mm256_loadu_pd(b.q + i);
+        const __m256d w = _mm256_fmsub_pd(_mm256_set1_pd(2.0), _mm256_loadu_pd(b.type + i), _mm256_set1_pd(1.0));
+        const __m256d sqrtT = _mm256_sqrt_pd(T);
+        const __m256d vol = _mm256_mul_pd(sigma, sqrtT);
+        const __m256d drift = _mm256_fmadd_pd(_mm256_mul_pd(_mm256_set1_pd(0.5), sigma), sigma, _mm256_sub_pd(r, q));
+        const __m256d d1 = _mm256_div_pd(_mm256_fmadd_pd(drift, T, logAvx2(_mm256_div_pd(S, K))), vol);
+        const __m256d discount = expAvx2(_mm256_mul_pd(_mm256_sub_pd(_mm256_setzero_pd(), r), T));
+        const __m256d carry = expAvx2(_mm256_mul_pd(_mm256_sub_pd(_mm256_setzero_pd(), q), T));
+        const __m256d spot = _mm256_mul_pd(S, carry);
+        __m256d gauss, unused;
+        const __m256d n1 = normalCdfAvx2(_mm256_mul_pd(w, d1), gauss);
+        const __m256d n2 = normalCdfAvx2(_mm256_mul_pd(w, _mm256_sub_pd(d1, vol)), unused);
+        const __m256d density = _mm256_div_pd(gauss, _mm256_set1_pd(sqrtTwoPi));
+        const __m256d strikePart = _mm256_mul_pd(_mm256_mul_pd(K, discount), n2);
+        const __m256d sDensity = _mm256_mul_pd(spot, density);
+        _mm256_storeu_pd(b.price + i, _mm256_mul_pd(w, _mm256_fmsub_pd(spot, n1, strikePart)));
+        _mm256_storeu_pd(b.delta + i, _mm256_mul_pd(_mm256_mul_pd(w, carry), n1));
+        _mm256_storeu_pd(b.gamma + i, _mm256_div_pd(_mm256_mul_pd(carry, density), _mm256_mul_pd(S, vol)));
+        _mm256_storeu_pd(b.vega + i, _mm256_mul_pd(sDensity, sqrtT));
+        const __m256d decay = _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(-0.5), sDensity), sigma), sqrtT);
+        const __m256d theta = _mm256_fnmadd_pd(_mm256_mul_pd(w, r), strikePart, decay);
+        _mm256_storeu_pd(b.theta + i, _mm256_fmadd_pd(_mm256_mul_pd(w, q), _mm256_mul_pd(spot, n1), theta));
+        _mm256_storeu_pd(b.rho + i, _mm256_mul_pd(_mm256_mul_pd(w, T), strikePart));
+        _mm256_storeu_pd(b.dStrike + i, _mm256_sub_pd(_mm256_setzero_pd(), _mm256_mul_pd(_mm256_mul_pd(w, discount), n2)));
+    }
+    analyticScalar(b, i, end);
+}
+
+// GCC signale à tort comme non initialisé le _mm512_undefined_pd() interne à plusieurs intrinsèques AVX-512 (min, max, sqrt, getexp...)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f")))
+static inline __m512d expAvx512(__m512d x) {
+    x = _mm512_max_pd(_mm512_min_pd(x, _mm512_set1_pd(expLimit)), _mm512_set1_pd(-expLimit));
+    const __m512d n = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(1.4426950408889634)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512d t = _mm512_fnmadd_pd(n, _mm512_set1_pd(ln2Hi), x);
+    t = _mm512_fnmadd_pd(n, _mm512_set1_pd(ln2Lo), t);
+    __m512d p = _mm512_set1_pd(expTaylor[0]);
+    for (int i = 1; i < 13; i++) p = _mm512_fmadd_pd(p, t, _mm512_set1_pd(expTaylor[i]));
+    return _mm512_scalef_pd(p, n); // p * 2^n
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d logAvx512(__m512d x) { // x > 0 normalisé
+    __m512d e = _mm512_getexp_pd(x);
+    __m512d m = _mm512_getmant_pd(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero);
+    const __mmask8 big = _mm512_cmp_pd_mask(m, _mm512_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+    m = _mm512_mask_mul_pd(m, big, m, _mm512_set1_pd(0.5));
+    e = _mm512_mask_add_pd(e, big, e, _mm512_set1_pd(1.0));
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d s = _mm512_div_pd(_mm512_sub_pd(m, one), _mm512_add_pd(m, one));
+    const __m512d z = _mm512_mul_pd(s, s);
+    __m512d p = _mm512_set1_pd(atanhSeries[0]);
+    for (int i = 1; i < 10; i++) p = _mm512_fmadd_pd(p, z, _mm512_set1_pd(atanhSeries[i]));
+    const __m512d lnm = _mm512_mul_pd(_mm512_add_pd(s, s), p);
+    return _mm512_fmadd_pd(e, _mm512_set1_pd(ln2Hi), _mm512_fmadd_pd(e, _mm512_set1_pd(ln2Lo), lnm));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d normalCdfAvx512(__m512d x, __m512d& gauss) {
+    const __m512d xa = _mm512_abs_pd(x);
+    gauss = expAvx512(_mm512_mul_pd(_mm512_set1_pd(-0.5), _mm512_mul_pd(xa, xa)));
+    __m512d num = _mm512_set1_pd(hartNumerator[0]), den = _mm512_set1_pd(hartDenominator[0]);
+    for (int i = 1; i < 7; i++) num = _mm512_fmadd_pd(num, xa, _mm512_set1_pd(hartNumerator[i]));
+    for (int i = 1; i < 8; i++) den = _mm512_fmadd_pd(den, xa, _mm512_set1_pd(hartDenominator[i]));
+    __m512d fraction = _mm512_add_pd(xa, _mm512_set1_pd(0.65));
+    for (int k = 4; k >= 1; k--) fraction = _mm512_add_pd(xa, _mm512_div_pd(_mm512_set1_pd(k), fraction));
+    const __m512d nearTail = _mm512_div_pd(_mm512_mul_pd(gauss, num), den);
+    const __m512d farTail = _mm512_div_pd(gauss, _mm512_mul_pd(fraction, _mm512_set1_pd(sqrtTwoPi)));
+    __m512d tail = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(xa, _mm512_set1_pd(hartSwitch), _CMP_GE_OQ), nearTail, farTail);
+    tail = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(xa, _mm512_set1_pd(hartCutoff), _CMP_GT_OQ), tail, _mm512_setzero_pd());
+    return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_GT_OQ), tail, _mm512_sub_pd(_mm512_set1_pd(1.0), tail));
+}
+
+__attribute__((target("avx512f")))
+static void analyticAvx512(const AnalyticBlock& b, int begin, int end) {
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        const __m512d S = _mm512_loadu_pd(b.S0 + i), K = _mm512_loadu_pd(b.K + i), r = _mm512_loadu_pd(b.r + i);
+        const __m512d sigma = _mm512_loadu_pd(b.sigma + i), T = _mm512_loadu_pd(b.T + i), q = _mm512_loadu_pd(b.q + i);
+        const __m512d w = _mm512_fmsub_pd(_mm512_set1_pd(2.0), _mm512_loadu_pd(b.type + i), _mm512_set1_pd(1.0));
+        const __m512d sqrtT = _mm512_sqrt_pd(T);
+        const __m512d vol = _mm512_mul_pd(sigma, sqrtT);
+        const __m512d drift = _mm512_fmadd_pd(_mm512_mul_pd(_mm512_set1_pd(0.5), sigma), sigma, _mm512_sub_pd(r, q));
+        const __m512d d1 = _mm512_div_pd(_mm512_fmadd_pd(drift, T, logAvx512(_mm512_div_pd(S, K))), vol);
+        const __m512d discount = expAvx512(_mm512_mul_pd(_mm512_sub_pd(_mm512_setzero_pd(), r), T));
+        const __m512d carry = expAvx512(_mm512_mul_pd(_mm512_sub_pd(_mm512_setzero_pd(), q), T));
+        const __m512d spot = _mm512_mul_pd(S, carry);
+        __m512d gauss, unused;
+        const __m512d n1 = normalCdfAvx512(_mm512_mul_pd(w, d1), gauss);
+        const __m512d n2 = normalCdfAvx512(_mm512_mul_pd(w, _mm512_sub_pd(d1, vol)), unused);
+        const __m512d density = _mm512_div_pd(gauss, _mm512_set1_pd(sqrtTwoPi));
+        const __m512d strikePart = _mm512_mul_pd(_mm512_mul_pd(K, discount), n2);
+        const __m512d sDensity = _mm512_mul_pd(spot, density);
+        _mm512_storeu_pd(b.price + i, _mm512_mul_pd(w, _mm512_fmsub_pd(spot, n1, strikePart)));
+        _mm512_storeu_pd(b.delta + i, _mm512_mul_pd(_mm512_mul_pd(w, carry), n1));
+        _mm512_storeu_pd(b.gamma + i, _mm512_div_pd(_mm512_mul_pd(carry, density), _mm512_mul_pd(S, vol)));
+        _mm512_storeu_pd(b.vega + i, _mm512_mul_pd(sDensity, sqrtT));
+        const __m512d decay = _mm512_div_pd(_mm512_mul_pd(_mm512_mul_pd(_mm512_set1_pd(-0.5), sDensity), sigma), sqrtT);
+        const __m512d theta = _mm512_fnmadd_pd(_mm512_mul_pd(w, r), strikePart, decay);
+        _mm512_storeu_pd(b.theta + i, _mm512_fmadd_pd(_mm512_mul_pd(w, q), _mm512_mul_pd(spot, n1), theta));
+        _mm512_storeu_pd(b.rho + i, _mm512_mul_pd(_mm512_mul_pd(w, T), strikePart));
+        _mm512_storeu_pd(b.dStrike + i, _mm512_sub_pd(_mm512_setzero_pd(), _mm512_mul_pd(_mm512_mul_pd(w, discount), n2)));
+    }
+    analyticScalar(b, i, end);
+}
+#pragma GCC diagnostic pop
+#endif
+
+#ifdef EDP_NEON_KERNELS
+static inline float64x2_t expNeon(float64x2_t x) {
+    x = vmaxq_f64(vminq_f64(x, vdupq_n_f64(expLimit)), vdupq_n_f64(-expLimit));
+    const float64x2_t n = vrndnq_f64(vmulq_f64(x, vdupq_n_f64(1.4426950408889634)));
+    float64x2_t t = vfmsq_f64(x, n, vdupq_n_f64(ln2Hi));
+    t = vfmsq_f64(t, n, vdupq_n_f64(ln2Lo));
+    float64x2_t p = vdupq_n_f64(expTaylor[0]);
+    for (int i = 1; i < 13; i++) p = vfmaq_f64(vdupq_n_f64(expTaylor[i]), p, t);
+    const int64x2_t e = vaddq_s64(vcvtq_s64_f64(n), vdupq_n_s64(1023));
+    return vmulq_f64(p, vreinterpretq_f64_s64(vshlq_n_s64(e, 52)));
+}
+
+static inline float64x2_t logNeon(float64x2_t x) { // x > 0 normalisé
+    const uint64x2_t bits = vreinterpretq_u64_f64(x);
+    float64x2_t e = vsubq_f64(vcvtq_f64_u64(vshrq_n_u64(bits, 52)), vdupq_n_f64(1023.0));
+    float64x2_t m = vreinterpretq_f64_u64(vorrq_u64(vandq_u64(bits, vdupq_n_u64(0x000FFFFFFFFFFFFFULL)), vdupq_n_u64(0x3FF0000000000000ULL)));
+    const uint64x2_t big = vcgtq_f64(m, vdupq_n_f64(1.4142135623730951));
+    m = vbslq_f64(big, vmulq_f64(m, vdupq_n_f64(0.5)), m);
+    e = vbslq_f64(big, vaddq_f64(e, vdupq_n_f64(1.0)), e);
+    const float64x2_t one = vdupq_n_f64(1.0);
+    const float64x2_t s = vdivq_f64(vsubq_f64(m, one), vaddq_f64(m, one));
+    const float64x2_t z = vmulq_f64(s, s);
+    float64x2_t p = vdupq_n_f64(atanhSeries[0]);
+    for (int i = 1; i < 10; i++) p = vfmaq_f64(vdupq_n_f64(atanhSeries[i]), p, z);
+    const float64x2_t lnm = vmulq_f64(vaddq_f64(s, s), p);
+    return vfmaq_f64(vfmaq_f64(lnm, e, vdupq_n_f64(ln2Lo)), e, vdupq_n_f64(ln2Hi));
+}
+
+static inline float64x2_t normalCdfNeon(float64x2_t x, float64x2_t& gauss) {
+    const float64x2_t xa = vabsq_f64(x);
+    gauss = expNeon(vmulq_f64(vdupq_n_f64(-0.5), vmulq_f64(xa, xa)));
+    float64x2_t num = vdupq_n_f64(hartNumerator[0]), den = vdupq_n_f64(hartDenominator[0]);
+    for (int i = 1; i < 7; i++) num = vfmaq_f64(vdupq_n_f64(hartNumerator[i]), num, xa);
+    for (int i = 1; i < 8; i++) den = vfmaq_f64(vdupq_n_f64(hartDenominator[i]), den, xa);
+    float64x2_t fraction = vaddq_f64(xa, vdupq_n_f64(0.65));
+    for (int k = 4; k >= 1; k--) fraction = vaddq_f64(xa, vdivq_f64(vdupq_n_f64(k), fraction));
+    const float64x2_t nearTail = vdivq_f64(vmulq_f64(gauss, num), den);
+    const float64x2_t farTail = vdivq_f64(gauss, vmulq_f64(fraction, vdupq_n_f64(sqrtTwoPi)));
+    float64x2_t tail = vbslq_f64(vcgeq_f64(xa, vdupq_n_f64(hartSwitch)), farTail, nearTail);
+    tail = vbslq_f64(vcgtq_f64(xa, vdupq_n_f64(hartCutoff)), vdupq_n_f64(0.0), tail);
+    return vbslq_f64(vcgtq_f64(x, vdupq_n_f64(0.0)), vsubq_f64(vdupq_n_f64(1.0), tail), tail);
+}
+
+static void analyticNeon(const AnalyticBlock& b, int begin, int end) {
+    int i = begin;
+    for (; i + 2 <= end; i += 2) {
+        const float64x2_t S = vld1q_f64(b.S0 + i), K = vld1q_f64(b.K + i), r = vld1q_f64(b.r + i);
+        const float64x2_t sigma = vld1q_f64(b.sigma + i), T = vld1q_f64(b.T + i), q = vld1q_f64(b.q + i);
+        const float64x2_t w = vfmaq_f64(vdupq_n_f64(-1.0), vdupq_n_f64(2.0), vld1q_f64(b.type + i));
+        const float64x2_t sqrtT = vsqrtq_f64(T);
+        const float64x2_t vol = vmulq_f64(sigma, sqrtT);
+        const float64x2_t drift = vfmaq_f64(vsubq_f64(r, q), vmulq_f64(vdupq_n_f64(0.5), sigma), sigma);
+        const float64x2_t d1 = vdivq_f64(vfmaq_f64(logNeon(vdivq_f64(S, K)), drift, T), vol);
+        const float64x2_t discount = expNeon(vnegq_f64(vmulq_f64(r, T)));
+        const float64x2_t carry = expNeon(vnegq_f64(vmulq_f64(q, T)));
+        const float64x2_t spot = vmulq_f64(S, carry);
+        float64x2_t gauss, unused;
+        const float64x2_t n1 = normalCdfNeon(vmulq_f64(w, d1), gauss);
+        const float64x2_t n2 = normalCdfNeon(vmulq_f64(w, vsubq_f64(d1, vol)), unused);
+        const float64x2_t density = vdivq_f64(gauss, vdupq_n_f64(sqrtTwoPi));
+        const float64x2_t strikePart = vmulq_f64(vmulq_f64(K, discount), n2);
+        const float64x2_t sDensity = vmulq_f64(spot, density);
+        vst1q_f64(b.price + i, vmulq_f64(w, vsubq_f64(vmulq_f64(spot, n1), strikePart)));
+        vst1q_f64(b.delta + i, vmulq_f64(vmulq_f64(w, carry), n1));
+        vst1q_f64(b.gamma + i, vdivq_f64(vmulq_f64(carry, density), vmulq_f64(S, vol)));
+        vst1q_f64(b.vega + i, vmulq_f64(sDensity, sqrtT));
+        const float64x2_t decay = vdivq_f64(vmulq_f64(vmulq_f64(vdupq_n_f64(-0.5), sDensity), sigma), sqrtT);
+        const float64x2_t theta = vfmsq_f64(decay, vmulq_f64(w, r), strikePart);
+        vst1q_f64(b.theta + i, vfmaq_f64(theta, vmulq_f64(w, q), vmulq_f64(spot, n1)));
+        vst1q_f64(b.rho + i, vmulq_f64(vmulq_f64(w, T), strikePart));
+        vst1q_f64(b.dStrike + i, vnegq_f64(vmulq_f64(vmulq_f64(w, discount), n2)));
+    }
+    analyticScalar(b, i, end);
+}
+#endif
+
+class AnalyticPricer {
+public:
+    typedef FiniteDifferencePricer::Parameters Parameters;
+    typedef FiniteDifferencePricer::Result Result;
+    typedef FiniteDifferencePricer::BatchResult BatchResult;
+    typedef FiniteDifferencePricer::Kernel Kernel;
+
+    explicit AnalyticPricer(Kernel requested = Kernel::Auto) { // Même choix du jeu d'instructions que le stencil des différences finies
+        if (!FiniteDifferencePricer::kernelSupported(requested)) requested = Kernel::Auto;
+        if (requested == Kernel::Auto) {
+            requested = FiniteDifferencePricer::kernelSupported(Kernel::AVX512) ? Kernel::AVX512
+                      : FiniteDifferencePricer::kernelSupported(Kernel::AVX2) ? Kernel::AVX2
+                      : FiniteDifferencePricer::kernelSupported(Kernel::NEON) ? Kernel::NEON
+                      : Kernel::Scalar;
+        }
+        kernel = requested;
+        switch (kernel) {
+#ifdef EDP_X86_KERNELS
+        case Kernel::AVX512: analyticKernel = analyticAvx512; break;
+        case Kernel::AVX2: analyticKernel = analyticAvx2; break;
+#endif
+#ifdef EDP_NEON_KERNELS
+        case Kernel::NEON: analyticKernel = analyticNeon; break;
+#endif
+        default: analyticKernel = analyticScalar; break;
+        }
+    }
+
+    Kernel selectedKernel() const { return kernel; }
+
+    Result price(const Parameters& p) const {
+        BatchResult res;
+        res.assign(1, 0.0);
+        priceRange(&p, 1, res, 0);
+        Result out;
+        out.price = res.price[0];
+        out.delta = res.delta[0];
+        out.gamma = res.gamma[0];
+        out.theta = res.theta[0];
+        out.vega = res.vega[0];
+        out.rho = res.rho[0];
+        out.dStrike = res.dStrike[0];
+        out.dMaturity = res.dMaturity[0];
+        out.errorEstimate = 0.0; // Formule exacte
+        return out;
+    }
+
+    // Calcule les contrats book[0..n) dans res[offset..offset+n) ; res doit déjà avoir la bonne taille.
+    // Un contrat invalide (mêmes règles que la saisie) donne des résultats NaN.
+    void priceRange(const Parameters* book, std::size_t n, BatchResult& res, std::size_t offset) const {
+        alignas(64) double fields[7][blockSize]; // Bloc transposé : un tableau par champ de Parameters
+        for (std::size_t first = 0; first < n; first += blockSize) {
+            const int count = static_cast<int>(std::min<std::size_t>(blockSize, n - first));
+            for (int i = 0; i < count; i++) {
+                const Parameters& p = book[first + i];
+                fields[0][i] = p.type;
+                fields[1][i] = p.S0;
+                fields[2][i] = p.K;
+                fields[3][i] = p.r;
+                fields[4][i] = p.sigma;
+                fields[5][i] = p.T;
+                fields[6][i] = p.q;
+            }
+            const std::size_t at = offset + first;
+            const AnalyticBlock block = {fields[0], fields[1], fields[2], fields[3], fields[4], fields[5], fields[6],
+                                         &res.price[at], &res.delta[at], &res.gamma[at], &res.theta[at], &res.vega[at], &res.rho[at], &res.dStrike[at]};
+            analyticKernel(block, 0, count);
+            for (int i = 0; i < count; i++) {
+                res.dMaturity[at + i] = -res.theta[at + i]; // Theta est la dérivée par rapport au temps calendaire
+                if (FiniteDifferencePricer::parameterError(book[first + i])) {
+                    const double nan = std::numeric_limits<double>::quiet_NaN();
+                    res.price[at + i] = res.delta[at + i] = res.gamma[at + i] = res.theta[at + i] = nan;
+                    res.vega[at + i] = res.rho[at + i] = res.dStrike[at + i] = res.dMaturity[at + i] = nan;
+                }
+            }
+        }
+    }
+
+    // Portefeuille complet, découpé en plages contiguës entre les threads (toutes les formules coûtent le même temps)
+    BatchResult priceBatch(const std::vector<Parameters>& book, unsigned nThreads = 0) const {
+        const std::size_t n = book.size();
+        BatchResult res;
+        res.assign(n, 0.0);
+        if (n == 0) return res;
+        if (nThreads == 0) nThreads = std::max(1u, std::thread::hardware_concurrency());
+        nThreads = static_cast<unsigned>(std::min<std::size_t>(nThreads, (n + blockSize - 1) / blockSize));
+
+        auto worker = [&](unsigned t) {
+            const std::size_t begin = n * t / nThreads, end = n * (t + 1) / nThreads;
+            priceRange(book.data() + begin, end - begin, res, begin);
+        };
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < nThreads; t++) threads.emplace_back(worker, t);
+        worker(0);
+        for (std::thread& th : threads) th.join();
+        return res;
+    }
+
+private:
+    static constexpr std::size_t blockSize = 256; // Contrats transposés à la fois (14 Ko par bloc, dans le cache L1)
+    Kernel kernel;
+    AnalyticKernel analyticKernel;
+};
+
+#ifdef EDP_GPU
+// Moteur GPU des portefeuilles : chaque contrat est une petite EDP résolue par un bloc de threads, U et U_old en mémoire partagée.
+// Couvre le call et le put européens classiques sur la grille uniforme (même grille et mêmes pas que FiniteDifferencePricer) ;
+// les schémas theta résolvent chaque système par réduction cyclique parallèle (PCR) en mémoire partagée, les contrats d'un lot
+// formant un solveur tridiagonal par lots (un système par bloc). Prix, Delta, Gamma et Theta sont lus en S0 par interpolation linéaire.
+
+// Coefficients (j-1, j, j+1) de dt*L au noeud j de la grille uniforme (S_j = j*dS), comme FiniteDifferencePricer::operatorRow
+__device__ inline void gpuOperatorRow(int j, double sigma, double drift, double dt, double& lo, double& centre, double& up) {
+    const double alpha = 0.5 * sigma * sigma * j * j * dt;
+    const double beta = 0.5 * drift * j * dt;
+    lo = alpha - beta;
+    centre = -2.0 * alpha;
+    up = alpha + beta;
+}
+
+// Résout en place x[0..n-1] (noeuds 1..N-1) de (I - th*dt*L) x = second membre par PCR : log2(n) passes où chaque ligne élimine ses voisines
+// à distance s, écrites dans le second jeu de tableaux (a, b, c, d de n lignes chacun) pour que toutes les lectures précèdent les écritures
+__device__ void gpuSolveTheta(double* x, double* rows, int n, double th, double sigma, double drift, double r, double dt, double lower, double upper) {
+    double* A = rows;
+    double* B = rows + 4 * n;
+    for (int i = threadIdx.x; i < n; i += blockDim.x) {
+        double lo, centre, up;
+        gpuOperatorRow(i + 1, sigma, drift, dt, lo, centre, up);
+        A[i] = i > 0 ? -th * lo : 0.0;
+        A[n + i] = 1.0 + th * (r * dt - centre);
+        A[2 * n + i] = i < n - 1 ? -th * up : 0.0;
+        A[3 * n + i] = x[i] + (i == 0 ? th * lo * lower : 0.0) + (i == n - 1 ? th * up * upper : 0.0); // Conditions aux limites au nouveau temps
+    }
+    __syncthreads();
+    for (int stride = 1; stride < n; stride *= 2) {
+        for (int i = threadIdx.x; i < n; i += blockDim.x) {
+            double a = A[i], b = A[n + i], c = A[2 * n + i], d = A[3 * n + i];
+            const int im = i - stride, ip = i + stride;
+            if (im >= 0) {
+                const double alpha = -a / A[n + im];
+                b += alpha * A[2 * n + im];
+                d += alpha * A[3 * n + im];
+                a = alpha * A[im];
+            } else {
+                a = 0.0;
+            }
+            if (ip < n) {
+                const double gamma = -c / A[n + ip];
+                b += gamma * A[ip];
+                d += gamma * A[3 * n + ip];
+                c = gamma * A[2 * n + ip];
+            } else {
+                c = 0.0;
+            }
+            B[i] = a;
+            B[n + i] = b;
+            B[2 * n + i] = c;
+            B[3 * n + i] = d;
+        }
+        __syncthreads();
+        double* t = A;
+        A = B;
+        B = t;
+    }
+    for (int i = threadIdx.x; i < n; i += blockDim.x) x[i] = A[3 * n + i] / A[n + i];
+    __syncthreads();
+}
+
+// Un bloc par contrat : scheme vaut 0 (explicite), 1 (implicite) ou 2 (Crank-Nicolson, deux pas implicites de Rannacher).
+// results reçoit price, delta, gamma et theta de chaque contrat.
+__global__ void gpuSolveKernel(const FiniteDifferencePricer::Parameters* contracts, double* results, int count, int N, int requestedM, int scheme) {
+    extern __shared__ double shared[];
+    const int id = blockIdx.x;
+    if (id >= count) return;
+    const FiniteDifferencePricer::Parameters p = contracts[id];
+    const bool call = p.type == 1.0;
+    const double Smax = 4.0 * p.K, dS = Smax / N;
+    const double dtMax = p.T / 100.0;
+    double dt;
+    int M;
+    if (scheme == 0) { // Même saturation de la condition de stabilité que FiniteDifferencePricer::configureGrid
+        dt = fmin((dS * dS) / (p.sigma * p.sigma * Smax * Smax), dtMax);
+        M = static_cast<int>(p.T / dt) + 1;
+        if (requestedM >= M) {
+            M = requestedM;
+            dt = p.T / M;
+        }
+    } else {
+        M = requestedM > 0 ? requestedM : (N / 4 > 100 ? N / 4 : 100);
+        dt = p.T / M;
+    }
+    const double theta = scheme == 0 ? 0.0 : (scheme == 1 ? 1.0 : 0.5);
+    const double drift = p.r - p.q;
+    const double discount = exp(-p.r * dt);
+
+    double* u = shared; // Prix au temps m*dt
+    double* v = shared + (N + 1); // Prix au temps (m-1)*dt
+    double* rows = shared + 2 * (N + 1); // Tableaux de la PCR (schémas theta)
+    for (int j = threadIdx.x; j <= N; j += blockDim.x) {
+        const double S = j * dS;
+        u[j] = j == N ? (call ? Smax - p.K : 0.0) : (call ? fmax(S - p.K, 0.0) : fmax(p.K - S, 0.0));
+    }
+    __syncthreads();
+    for (int m = M; m > 0; m--) {
+        const double th = (scheme == 2 && m > M - 2) ? 1.0 : theta;
+        for (int j = 1 + threadIdx.x; j < N; j += blockDim.x) { // Pas explicite, ou second membre du schéma theta
+            double lo, centre, up;
+            gpuOperatorRow(j, p.sigma, drift, dt, lo, centre, up);
+            if (th != theta) v[j] = u[j]; // Pas de démarrage : second membre réduit à U^{m+1}
+            else v[j] = (1.0 - theta) * lo * u[j - 1] + (1.0 - (1.0 - theta) * (p.r * dt - centre)) * u[j] + (1.0 - theta) * up * u[j + 1];
+        }
+        if (threadIdx.x == 0) {
+            const double tau = p.T - (m - 1) * dt;
+            v[0] = u[0] * discount;
+            v[N] = call ? Smax * exp(-p.q * tau) - p.K * exp(-p.r * tau) : 0.0;
+        }
+        __syncthreads();
+        if (scheme != 0) gpuSolveTheta(v + 1, rows, N - 1, th, p.sigma, drift, p.r, dt, v[0], v[N]);
+        double* t = u; // Les deux buffers échangent leur rôle, comme U et U_old
+        u = v;
+        v = t;
+    }
+    if (threadIdx.x == 0) { // Lecture en S0, comme FiniteDifferencePricer::resultsAt avec l'interpolation linéaire
+        const double index = p.S0 / dS;
+        int j0 = static_cast<int>(floor(index));
+        if (j0 > N) j0 = N;
+        double w = index - j0;
+        if (j0 < N && w > 1.0 - 1e-9) {
+            j0++;
+            w = 0.0;
+        }
+        const double price = j0 < N ? (1.0 - w) * u[j0] + w * u[j0 + 1] : u[j0];
+        const double previous = j0 < N ? (1.0 - w) * v[j0] + w * v[j0 + 1] : v[j0];
+        double delta = 0.0, gamma = 0.0;
+        if (j0 > 0 && j0 < N) {
+            delta = (u[j0 + 1] - u[j0 - 1]) / (2.0 * dS);
+            gamma = (u[j0 + 1] - 2.0 * u[j0] + u[j0 - 1]) / (dS * dS);
+        }
+        double* out = results + 4 * static_cast<std::size_t>(id);
+        out[0] = price;
+        out[1] = delta;
+        out[2] = gamma;
+        out[3] = (previous - price) / dt;
+    }
+}
+
+// Calcul d'un portefeuille sur le GPU par lots de batchSize contrats. Deux lots sont en vol sur deux flux CUDA, avec des buffers
+// hôte verrouillés (pinned) : pendant que le GPU transfère et résout un lot, le thread appelant recopie les résultats du lot
+// précédent et remplit le suivant. Les contrats invalides ne sont pas envoyés (résultats NaN, comme FiniteDifferencePricer).
+class GpuBatchPricer {
+public:
+    typedef FiniteDifferencePricer::Parameters Parameters;
+    typedef FiniteDifferencePricer::GridSettings GridSettings;
+    typedef FiniteDifferencePricer::BatchResult BatchResult;
+
+    // Réglages traités par le GPU, ou nullptr
+    static const char* gridError(const GridSettings& g) {
+        if (g.spacing != FiniteDifferencePricer::Spacing::Uniform || g.richardson > 1 || g.tolerance > 0.0 || g.sensitivities) {
+            return "Erreur : le moteur GPU résout la grille uniforme, sans extrapolation, tolérance ni sensibilités adjointes.";
+        }
+        if (g.exercise != FiniteDifferencePricer::Exercise::European || g.payoff != FiniteDifferencePricer::Payoff::Vanilla || !g.market.empty()) {
+            return "Erreur : le moteur GPU ne couvre que le call et le put européens classiques à r et sigma constants.";
+        }
+        return g.N < 2 ? "Erreur : N doit être au moins 2." : nullptr;
+    }
+
+    explicit GpuBatchPricer(const GridSettings& grid)
+        : N(grid.N), requestedM(grid.M), scheme(grid.scheme == FiniteDifferencePricer::Scheme::Explicit ? 0 : grid.scheme == FiniteDifferencePricer::Scheme::Implicit ? 1 : 2) {
+        int devices = 0;
+        if (cudaGetDeviceCount(&devices) != cudaSuccess || devices == 0) {
+            message = "Erreur : aucun GPU CUDA disponible.";
+            return;
+        }
+        int limit = 0;
+        cudaDeviceGetAttribute(&limit, cudaDevAttrMaxSharedMemoryPerBlockOptin, 0);
+        sharedBytes = (2 * static_cast<std::size_t>(N + 1) + (scheme == 0 ? 0 : 8 * static_cast<std::size_t>(N - 1))) * sizeof(double);
+        if (sharedBytes > static_cast<std::size_t>(limit)
+            || cudaFuncSetAttribute(gpuSolveKernel, cudaFuncAttributeMaxDynamicSharedMemorySize, static_cast<int>(sharedBytes)) != cudaSuccess) {
+            message = "Erreur : N trop grand pour la mémoire partagée du GPU.";
+            return;
+        }
+        for (Slot& s : slots) {
+            if (cudaStreamCreate(&s.stream) != cudaSuccess
+                || cudaHostAlloc(reinterpret_cast<void**>(&s.hostIn), batchSize * sizeof(Parameters), cudaHostAllocDefault) != cudaSuccess
+                || cudaHostAlloc(reinterpret_cast<void**>(&s.hostOut), batchSize * resultFields * sizeof(double), cudaHostAllocDefault) != cudaSuccess
+                || cudaMalloc(reinterpret_cast<void**>(&s.deviceIn), batchSize * sizeof(Parameters)) != cudaSuccess
+                || cudaMalloc(reinterpret_cast<void**>(&s.deviceOut), batchSize * resultFields * sizeof(double)) != cudaSuccess) {
+                message = "Erreur : allocation des buffers du GPU impossible.";
+                return;
+            }
+            s.valid.resize(batchSize);
+        }
+    }
+
+    ~GpuBatchPricer() {
+        for (Slot& s : slots) {
+            if (s.stream) cudaStreamSynchronize(s.stream);
+            cudaFreeHost(s.hostIn);
+            cudaFreeHost(s.hostOut);
+            cudaFree(s.deviceIn);
+            cudaFree(s.deviceOut);
+            if (s.stream) cudaStreamDestroy(s.stream);
+        }
+    }
+
+    GpuBatchPricer(const GpuBatchPricer&) = delete;
+    GpuBatchPricer& operator=(const GpuBatchPricer&) = delete;
+
+    const char* error() const { return message; } // nullptr si le GPU est prêt
+
+    // Écrit les résultats de book[0..n) dans res à partir de l'indice offset (res doit déjà contenir offset + n contrats)
+    void priceRange(const Parameters* book, std::size_t n, BatchResult& res, std::size_t offset) {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        if (message) {
+            for (std::size_t i = 0; i < n; i++) res.store(offset + i, {nan, nan, nan, nan});
+            return;
+        }
+        auto harvest = [&](Slot& s) { // Attend le lot en vol sur ce flux et recopie ses résultats
+            if (!s.busy) return;
+            const bool ok = cudaStreamSynchronize(s.stream) == cudaSuccess;
+            for (std::size_t i = 0; i < s.count; i++) {
+                const double* r = s.hostOut + resultFields * i;
+                if (ok && s.valid[i]) res.store(s.begin + i, {r[0], r[1], r[2], r[3]});
+                else res.store(s.begin + i, {nan, nan, nan, nan});
+            }
+            s.busy = false;
+        };
+        int current = 0;
+        for (std::size_t begin = 0; begin < n; begin += batchSize, current ^= 1) {
+            Slot& s = slots[current];
+            harvest(s);
+            s.begin = offset + begin;
+            s.count = std::min(batchSize, n - begin);
+            for (std::size_t i = 0; i < s.count; i++) {
+                const Parameters& p = book[begin + i];
+                s.valid[i] = FiniteDifferencePricer::parameterError(p) == nullptr;
+                s.hostIn[i] = s.valid[i] ? p : placeholder; // Un contrat valide quelconque occupe la place d'un contrat invalide
+            }
+            cudaMemcpyAsync(s.deviceIn, s.hostIn, s.count * sizeof(Parameters), cudaMemcpyHostToDevice, s.stream);
+            gpuSolveKernel<<<static_cast<unsigned>(s.count), threadsPerBlock, sharedBytes, s.stream>>>(s.deviceIn, s.deviceOut, static_cast<int>(s.count), N, requestedM, scheme);
+            cudaMemcpyAsync(s.hostOut, s.deviceOut, s.count * resultFields * sizeof(double), cudaMemcpyDeviceToHost, s.stream);
+            s.busy = true;
+        }
+        harvest(slots[current]);
+        harvest(slots[current ^ 1]);
+    }
+
+private:
+    static constexpr std::size_t batchSize = 8192; // Contrats par transfert (un bloc par contrat : assez pour occuper tous les multiprocesseurs)
+    static constexpr std::size_t resultFields = 4; // price, delta, gamma, theta
+    static constexpr unsigned threadsPerBlock = 256;
+    static constexpr Parameters placeholder = {1.0, 100.0, 100.0, 0.05, 0.2, 1.0, 0.0};
+
+    struct Slot { // Un lot en vol : flux, buffers hôte verrouillés et buffers du GPU
+        cudaStream_t stream = nullptr;
+        Parameters* hostIn = nullptr;
+        double* hostOut = nullptr;
+        Parameters* deviceIn = nullptr;
+        double* deviceOut = nullptr;
+        std::size_t begin = 0, count = 0;
+        bool busy = false;
+        std::vector<char> valid; // Contrats envoyés au GPU (les autres reçoivent NaN)
+    };
+
+    int N;
+    int requestedM;
+    int scheme;
+    std::size_t sharedBytes = 0;
+    Slot slots[2];
+    const char* message = nullptr;
+};
+#endif
+
+// Mode non interactif : les options viennent de la ligne de commande et/ou d'un fichier de configuration
+// (une option "clé = valeur" par ligne, # pour les commentaires ; la ligne de commande l'emporte sur le fichier).
+// Exemples : ./pricer --type call --S0 100 --K 100 --r 0.05 --sigma 0.2 --T 1 --N 400 --scheme cn
+//            ./pricer --batch book.csv --output prices.csv --mode precis
+// Sans argument, le programme reste interactif.
+
+typedef std::map<std::string, std::string> Options;
+
+enum class Engine { FiniteDifference, Analytic, Validate, Gpu }; // Validate : différences finies, plus l'écart à la formule fermée pour chaque contrat ; Gpu : différences finies sur le GPU (EDP_GPU)
+
+static void printUsage() {
+    std::cout << "Utilisation : pricer [options]\n"
+                 "  --type call|put|1|0   --S0 x  --K x  --r x  --sigma x  --T x   Caractéristiques de l'option\n"
+                 "  --q x                 Taux de dividende continu (0 par défaut)\n"
+                 "  --dividends t1:D1,t2:D2,...  Dividendes en numéraire D1 détaché en t1, D2 en t2... (différences finies seulement)\n"
+                 "  --mode precis|rapide|resserre|extrapole  Préréglage de la grille (N = 2000, N = 100, N = 500 non uniforme, N = 100 extrapolé sur 3 grilles)\n"
+                 "  --tolerance x         Erreur absolue visée sur le prix : N et M sont choisis par raffinements successifs\n"
+                 "  --richardson n        Extrapolation de Richardson sur n grilles emboîtées N, 2N, 4N (n = 2 ou 3)\n"
+                 "  --grid uniform|stretched  Noeuds uniformes ou resserrés autour de S0 et K\n"
+                 "  --interpolation cubic|linear  Lecture du prix et des Grecques en S0 (cubic par défaut)\n"
+                 "  --N n  --M m          Nombre de pas spatiaux et temporels (M : schéma explicite seulement au-delà du minimum de stabilité)\n"
+                 "  --scheme explicit|implicit|cn   --kernel auto|scalar|avx2|avx512|neon\n"
+                 "  --precision double|float|mixed  Remontée en double, en float, ou coefficients en float et prix en double (européen, r et sigma constants)\n"
+                 "  --exercise european|american|bermudan  Style d'exercice (européen par défaut)\n"
+                 "  --dates t1,t2,...     Dates d'exercice anticipé d'une option bermudéenne (en années)\n"
+                 "  --payoff vanilla|digital|up-and-out  Call ou put classique, cash-or-nothing, ou désactivé quand S atteint la barrière\n"
+                 "  --barrier x           Niveau de la barrière (--payoff up-and-out), au-dessus de S0 et de K\n"
+                 "  --rate-curve t1:r1,t2:r2,...  Taux r1 jusqu'à t1, r2 jusqu'à t2... (le dernier au-delà), remplace --r dans l'EDP\n"
+                 "  --vol-curve t1:s1,t2:s2,...   Volatilité par intervalle de temps, remplace --sigma dans l'EDP\n"
+                 "  --local-vol file.csv  Surface sigma(S, t) : ligne d'en-tête time,S1,S2,... puis une ligne t,sigma1,sigma2,... par intervalle\n"
+                 "  --engine fd|analytic|validate|gpu  Différences finies, formule fermée de Black-Scholes, les deux avec l'écart par contrat,\n"
+                 "                        ou différences finies sur le GPU (--batch, européen classique, grille uniforme ; compiler avec nvcc -x cu)\n"
+                 "  --batch file          Calcule tous les contrats du fichier (CSV type,S0,K,r,sigma,T[,q] ou binaire EDPC)\n"
+                 "  --output file         Fichier de résultats du mode batch (sortie standard par défaut)\n"
+                 "  --format csv|binary   Format des résultats du mode batch (binaire : enregistrements EDPR price,delta,gamma,theta)\n"
+                 "  --surface file.csv    Écrit prix et Grecques en chaque noeud de la grille (calcul d'un seul contrat)\n"
+                 "  --snapshot file.bin   Écrit la grille des prix à t=0 au format binaire EDPG, à projeter en mémoire (calcul d'un seul contrat)\n"
+                 "  --snapshot-times t1,t2,...  Avec --snapshot : garde aussi les niveaux de ces dates (en années, au pas de temps le plus proche)\n"
+                 "  --threads n           Nombre de threads du mode batch, ou d'un seul contrat sur une grande grille (0 : tous les coeurs)\n"
+                 "  --config file         Fichier de configuration contenant les mêmes options\n"
+                 "  --bench               Mesure le solveur sur la grille standard (N, schéma, noyau) et écrit les résultats en JSON (--output)\n"
+                 "  --baseline file.json  Avec --bench : compare aux résultats d'une version précédente (code de retour 2 si régression)\n"
+                 "  --precision-report    Écart des remontées float et mixte à la remontée double sur les contrats de --bench (CSV, --output)\n"
+                 "  --stats               Affiche sur la sortie d'erreur le temps de chaque phase, les pas et noeuds calculés et dt / dt_stabilité\n"
+                 "  --trace file.json     Écrit les phases du calcul au format Chrome trace (--stats et --trace : compiler avec -DEDP_INSTRUMENTATION)\n"
+                 "  --serve [addr:]port   Mode service : calcule les requêtes binaires EDPQ reçues en TCP par micro-lots (127.0.0.1 par défaut)\n"
+                 "  --cache n             Avec --serve : nombre de résultats gardés dans le cache LRU (100000 par défaut, 0 : sans cache)\n"
+                 "  --window us           Avec --serve : attente maximale en microsecondes avant le départ d'un micro-lot (200 par défaut)\n";
+}
+
+static bool parseNumber(const std::string& text, double& value) {
+    const char* begin = text.c_str();
+    char* end = nullptr;
+    value = std::strtod(begin, &end);
+    return end != begin && *end == '\0';
+}
+
+static bool parseOptionType(const std::string& text, double& type) {
+    if (text == "call") { type = 1; return true; }
+    if (text == "put") { type = 0; return true; }
+    return parseNumber(text, type);
+}
+
+static std::string trim(const std::string& text) {
+    const std::size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) return "";
+    return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+static bool loadConfigFile(const std::string& path, Options& options) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Erreur : impossible d'ouvrir le fichier de configuration " << path << ".\n";
+        return false;
+    }
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        std::size_t sep = line.find_first_of("= \t");
+        if (sep == std::string::npos) {
+            std::cerr << "Erreur : " << path << ", ligne " << lineNumber << " : valeur manquante.\n";
+            return false;
+        }
+        std::string key = trim(line.substr(0, sep));
+        std::string value = trim(line.substr(sep + 1));
+        if (!value.empty() && value[0] == '=') value = trim(value.substr(1));
+        if (key.compare(0, 2, "--") == 0) key = key.substr(2);
+        options[key] = value;
+    }
+    return true;
+}
+
+// Courbe "t1:v1,t2:v2,..." : v1 jusqu'à t1, v2 jusqu'à t2, etc.
+static bool parseCurve(const std::string& name, const std::string& text, FiniteDifferencePricer::Curve& curve) {
+    std::size_t begin = 0;
+    for (;;) {
+        const std::size_t end = std::min(text.find(',', begin), text.size());
+        const std::string item = text.substr(begin, end - begin);
+        const std::size_t sep = item.find(':');
+        double t, v;
+        if (sep == std::string::npos || !parseNumber(trim(item.substr(0, sep)), t) || !parseNumber(trim(item.substr(sep + 1)), v)) {
+            std::cerr << "Erreur : --" << name << " attend des paires date:valeur séparées par des virgules.\n";
+            return false;
+        }
+        curve.times.push_back(t);
+        curve.values.push_back(v);
+        if (end == text.size()) return true;
+        begin = end + 1;
+    }
+}
+
+// Surface de volatilité locale en CSV (séparateur , ou ;) : "time,S1,S2,..." puis "t,sigma(S1),sigma(S2),..." par intervalle
+static bool loadLocalVolatility(const std::string& path, FiniteDifferencePricer::LocalVolatility& lv) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Erreur : impossible d'ouvrir la surface de volatilité locale " << path << ".\n";
+        return false;
+    }
+    std::string line;
+    int lineNumber = 0;
+    bool header = true;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        std::vector<double> row;
+        std::size_t begin = 0;
+        bool ok = true;
+        for (int k = 0;; k++) {
+            const std::size_t end = std::min(line.find_first_of(",;", begin), line.size());
+            const std::string field = trim(line.substr(begin, end - begin));
+            double value;
+            if (header && k == 0) ok = !field.empty(); // Libellé de la colonne des dates
+            else if (parseNumber(field, value)) row.push_back(value);
+            else ok = false;
+            if (!ok || end == line.size()) break;
+            begin = end + 1;
+        }
+        if (!ok || row.empty() || (!header && row.size() != lv.spots.size() + 1)) {
+            std::cerr << "Erreur : " << path << ", ligne " << lineNumber << " : ligne de volatilité locale invalide.\n";
+            return false;
+        }
+        if (header) {
+            lv.spots = row;
+            header = false;
+            continue;
+        }
+        lv.times.push_back(row[0]);
+        lv.values.insert(lv.values.end(), row.begin() + 1, row.end());
+    }
+    if (lv.times.empty()) {
+        std::cerr << "Erreur : " << path << " ne contient aucune ligne de volatilité locale.\n";
+        return false;
+    }
+    return true;
+}
+
+static bool parseCommandLine(int argc, char** argv, Options& options) {
+    Options cli;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            cli["help"] = "1";
+            continue;
+        }
+        if (arg == "--bench" || arg == "--precision-report" || arg == "--stats") { // Options sans valeur
+            cli[arg.substr(2)] = "1";
+            continue;
+        }
+        if (arg.compare(0, 2, "--") != 0 || i + 1 >= argc) {
+            std::cerr << "Erreur : option invalide ou sans valeur : " << arg << "\n";
+            return false;
+        }
+        cli[arg.substr(2)] = argv[++i];
+    }
+    if (cli.count("config") && !loadConfigFile(cli["config"], options)) return false;
+    for (const auto& kv : cli) options[kv.first] = kv.second;
+    return true;
+}
+
+static bool buildGridSettings(const Options& options, FiniteDifferencePricer::GridSettings& grid) {
+    typedef FiniteDifferencePricer P;
+    static const char* known[] = {"type", "S0", "K", "r", "sigma", "T", "q", "mode", "N", "M", "grid", "interpolation", "richardson", "tolerance", "scheme", "kernel", "precision", "exercise", "dates", "payoff", "barrier", "rate-curve", "vol-curve", "local-vol", "dividends", "engine", "batch", "output", "format", "surface", "threads", "config", "bench", "baseline", "precision-report", "stats", "trace", "serve", "cache", "window", "snapshot", "snapshot-times", "help"};
+    for (const auto& kv : options) {
+        if (std::find_if(std::begin(known), std::end(known), [&](const char* k) { return kv.first == k; }) == std::end(known)) {
+            std::cerr << "Erreur : option inconnue : --" << kv.first << "\n";
+            return false;
+        }
+    }
+
+    auto it = options.find("scheme");
+    if (it != options.end()) {
+        if (it->second == "explicit") grid.scheme = P::Scheme::Explicit;
+        else if (it->second == "implicit") grid.scheme = P::Scheme::Implicit;
+        else if (it->second == "cn" || it->second == "crank-nicolson") grid.scheme = P::Scheme::CrankNicolson;
+        else { std::cerr << "Erreur : schéma inconnu : " << it->second << "\n"; return false; }
+    }
+
+    it = options.find("kernel");
+    if (it != options.end()) {
+        const P::Kernel kernels[] = {P::Kernel::Auto, P::Kernel::Scalar, P::Kernel::AVX2, P::Kernel::AVX512, P::Kernel::NEON};
+        const P::Kernel* k = std::find_if(std::begin(kernels), std::end(kernels), [&](P::Kernel x) { return it->second == P::kernelName(x); });
+        if (k == std::end(kernels)) { std::cerr << "Erreur : noyau inconnu : " << it->second << "\n"; return false; }
+        grid.kernel = *k;
+    }
+
+    it = options.find("precision");
+    if (it != options.end()) {
+        const P::Precision precisions[] = {P::Precision::Double, P::Precision::Float, P::Precision::Mixed};
+        const P::Precision* p = std::find_if(std::begin(precisions), std::end(precisions), [&](P::Precision x) { return it->second == P::precisionName(x); });
+        if (p == std::end(precisions)) { std::cerr << "Erreur : précision inconnue : " << it->second << "\n"; return false; }
+        grid.precision = *p;
+    }
+
+    grid.N = 100; // Mode Rapide par défaut, comme en interactif
+    it = options.find("mode");
+    if (it != options.end()) {
+        if (it->second == "precis" || it->second == "1") grid.N = 2000;
+        else if (it->second == "rapide" || it->second == "2") grid.N = 100;
+        else if (it->second == "resserre" || it->second == "4") {
+            grid.N = 500;
+            grid.spacing = P::Spacing::Stretched;
+        }
+        else if (it->second == "extrapole" || it->second == "5") {
+            grid.N = 100;
+            grid.richardson = 3;
+        }
+        else { std::cerr << "Erreur : mode inconnu : " << it->second << "\n"; return false; }
+    }
+
+    it = options.find("grid");
+    if (it != options.end()) {
+        if (it->second == "uniform") grid.spacing = P::Spacing::Uniform;
+        else if (it->second == "stretched") grid.spacing = P::Spacing::Stretched;
+        else { std::cerr << "Erreur : grille inconnue : " << it->second << "\n"; return false; }
+    }
+
+    it = options.find("interpolation");
+    if (it != options.end()) {
+        if (it->second == "cubic") grid.interpolation = P::Interpolation::Cubic;
+        else if (it->second == "linear") grid.interpolation = P::Interpolation::Linear;
+        else { std::cerr << "Erreur : interpolation inconnue : " << it->second << "\n"; return false; }
+    }
+
+    it = options.find("exercise");
+    if (it != options.end()) {
+        if (it->second == "european") grid.exercise = P::Exercise::European;
+        else if (it->second == "american") grid.exercise = P::Exercise::American;
+        else if (it->second == "bermudan") grid.exercise = P::Exercise::Bermudan;
+        else { std::cerr << "Erreur : style d'exercice inconnu : " << it->second << "\n"; return false; }
+    }
+
+    double value;
+    it = options.find("dates");
+    if (it != options.end()) {
+        std::size_t begin = 0;
+        for (;;) {
+            const std::size_t end = std::min(it->second.find(',', begin), it->second.size());
+            if (!parseNumber(trim(it->second.substr(begin, end - begin)), value) || value < 0) {
+                std::cerr << "Erreur : --dates attend des dates positives séparées par des virgules.\n";
+                return false;
+            }
+            grid.exerciseDates.push_back(value);
+            if (end == it->second.size()) break;
+            begin = end + 1;
+        }
+    }
+    it = options.find("snapshot-times");
+    if (it != options.end()) {
+        std::size_t begin = 0;
+        for (;;) {
+            const std::size_t end = std::min(it->second.find(',', begin), it->second.size());
+            if (!parseNumber(trim(it->second.substr(begin, end - begin)), value) || !(value > 0)) {
+                std::cerr << "Erreur : --snapshot-times attend des dates strictement positives séparées par des virgules.\n";
+                return false;
+            }
+            grid.snapshotTimes.push_back(value);
+            if (end == it->second.size()) break;
+            begin = end + 1;
+        }
+    }
+    it = options.find("payoff");
+    if (it != options.end()) {
+        if (it->second == "vanilla") grid.payoff = P::Payoff::Vanilla;
+        else if (it->second == "digital") grid.payoff = P::Payoff::Digital;
+        else if (it->second == "up-and-out") grid.payoff = P::Payoff::UpAndOut;
+        else { std::cerr << "Erreur : payoff inconnu : " << it->second << "\n"; return false; }
+    }
+    it = options.find("barrier");
+    if (it != options.end() && (!parseNumber(it->second, grid.barrier) || !(grid.barrier > 0))) {
+        std::cerr << "Erreur : --barrier doit être strictement positive.\n";
+        return false;
+    }
+    if (grid.payoff == P::Payoff::UpAndOut && it == options.end()) {
+        std::cerr << "Erreur : une option à barrière demande son niveau (--barrier).\n";
+        return false;
+    }
+    if (grid.exercise == P::Exercise::Bermudan && grid.exerciseDates.empty()) {
+        std::cerr << "Erreur : une option bermudéenne demande ses dates d'exercice (--dates).\n";
+        return false;
+    }
+    it = options.find("rate-curve");
+    if (it != options.end() && !parseCurve(it->first, it->second, grid.market.rate)) return false;
+    it = options.find("vol-curve");
+    if (it != options.end() && !parseCurve(it->first, it->second, grid.market.volatility)) return false;
+    it = options.find("local-vol");
+    if (it != options.end() && !loadLocalVolatility(it->second, grid.market.localVolatility)) return false;
+    it = options.find("dividends");
+    if (it != options.end()) {
+        P::Curve schedule; // Mêmes paires date:montant que les courbes
+        if (!parseCurve(it->first, it->second, schedule)) return false;
+        grid.market.dividends.times.swap(schedule.times);
+        grid.market.dividends.amounts.swap(schedule.values);
+    }
+    if (const char* e = P::marketError(grid.market)) {
+        std::cerr << e << "\n";
+        return false;
+    }
+
+    it = options.find("N");
+    if (it != options.end()) {
+        if (!parseNumber(it->second, value) || value < 2) { std::cerr << "Erreur : N doit être un entier supérieur ou égal à 2.\n"; return false; }
+        grid.N = static_cast<int>(value);
+    }
+    it = options.find("M");
+    if (it != options.end()) {
+        if (!parseNumber(it->second, value) || value < 1) { std::cerr << "Erreur : M doit être un entier strictement positif.\n"; return false; }
+        grid.M = static_cast<int>(value);
+    }
+    it = options.find("richardson");
+    if (it != options.end()) {
+        if (!parseNumber(it->second, value) || value < 1 || value > 3) { std::cerr << "Erreur : --richardson doit valoir 1, 2 ou 3.\n"; return false; }
+        grid.richardson = static_cast<int>(value);
+    }
+    it = options.find("tolerance");
+    if (it != options.end()) {
+        if (!parseNumber(it->second, value) || !(value > 0)) { std::cerr << "Erreur : --tolerance doit être strictement positive.\n"; return false; }
+        grid.tolerance = value;
+    }
+    return true;
+}
+
+static bool buildParameters(const Options& options, FiniteDifferencePricer::Parameters& params) {
+    struct Field { const char* name; double* value; };
+    const Field fields[] = {{"S0", &params.S0}, {"K", &params.K}, {"r", &params.r}, {"sigma", &params.sigma}, {"T", &params.T}};
+
+    auto it = options.find("type");
+    if (it == options.end() || !parseOptionType(it->second, params.type)) {
+        std::cerr << "Erreur : --type call|put est obligatoire.\n";
+        return false;
+    }
+    for (const Field& f : fields) {
+        it = options.find(f.name);
+        if (it == options.end() || !parseNumber(it->second, *f.value)) {
+            std::cerr << "Erreur : --" << f.name << " est obligatoire et doit être un nombre.\n";
+            return false;
+        }
+    }
+    it = options.find("q");
+    if (it != options.end() && !parseNumber(it->second, params.q)) {
+        std::cerr << "Erreur : --q doit être un nombre.\n";
+        return false;
+    }
+    if (const char* e = FiniteDifferencePricer::parameterError(params)) {
+        std::cerr << e << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Lit une ligne de contrat "type,S0,K,r,sigma,T[,q]" (séparateur , ou ;) directement dans le fichier projeté en mémoire
+static bool parseContractLine(const char* begin, const char* end, FiniteDifferencePricer::Parameters& p) {
+    double* values[] = {&p.type, &p.S0, &p.K, &p.r, &p.sigma, &p.T, &p.q};
+    const char* pos = begin;
+    for (int f = 0; f < 7; f++) {
+        while (pos < end && (*pos == ' ' || *pos == '\t')) pos++;
+        if (f == 0 && end - pos >= 4 && std::memcmp(pos, "call", 4) == 0) { p.type = 1; pos += 4; }
+        else if (f == 0 && end - pos >= 3 && std::memcmp(pos, "put", 3) == 0) { p.type = 0; pos += 3; }
+        else {
+            if (pos < end && *pos == '+') pos++; // from_chars n'accepte pas le signe +
+            std::from_chars_result res = std::from_chars(pos, end, *values[f]);
+            if (res.ec != std::errc()) return false;
+            pos = res.ptr;
+        }
+        while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r')) pos++;
+        if (f == 5 && pos == end) return true; // Sans colonne q : pas de dividende continu
+        if (f < 6) {
+            if (pos == end || (*pos != ',' && *pos != ';')) return false;
+            pos++;
+        }
+    }
+    return pos == end;
+}
+
+static void appendNumber(std::string& out, double value) {
+    char buffer[32];
+    std::to_chars_result res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, res.ptr);
+}
+
+// Format binaire à enregistrements de taille fixe (ordre des octets de la machine) : un en-tête de 16 octets puis les enregistrements.
+// Contrats ("EDPC") : les 7 doubles de Parameters dans l'ordre de la structure (version 1 : 6 doubles, sans q). Résultats ("EDPR") : price, delta, gamma, theta.
+struct BinaryHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t recordSize; // Taille d'un enregistrement en octets
+    std::uint32_t reserved;
+};
+static_assert(sizeof(BinaryHeader) == 16, "en-tête binaire de 16 octets");
+static_assert(sizeof(FiniteDifferencePricer::Parameters) == 7 * sizeof(double), "Parameters doit rester un enregistrement de 7 doubles");
+
+static const char contractMagic[4] = {'E', 'D', 'P', 'C'};
+static const char resultMagic[4] = {'E', 'D', 'P', 'R'};
+static const std::uint32_t binaryVersion = 2; // Version des enregistrements de contrats (2 : ajout de q)
+static const std::size_t legacyContractSize = 6 * sizeof(double); // Enregistrements de la version 1
+static const std::uint32_t resultVersion = 2; // Version des enregistrements de résultats (2 : ajout de theta)
+static const std::size_t resultFields = 4;
+
+// Fichier d'entrée projeté en mémoire (lecture complète en mémoire sur les systèmes sans mmap)
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef EDP_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0) {
+            length = static_cast<std::size_t>(st.st_size);
+            if (length == 0) {
+                ok = true;
+            } else {
+                void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    mapped = static_cast<const char*>(p);
+                    ::madvise(p, length, MADV_SEQUENTIAL);
+                    ok = true;
+                }
+            }
+        }
+        ::close(fd);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return;
+        copy.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        length = copy.size();
+        ok = true;
+#endif
+    }
+    ~MappedFile() {
+#ifdef EDP_MMAP
+        if (mapped) ::munmap(const_cast<char*>(mapped), length);
+#endif
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool valid() const { return ok; }
+    const char* data() const {
+#ifdef EDP_MMAP
+        return mapped;
+#else
+        return copy.data();
+#endif
+    }
+    std::size_t size() const { return length; }
+
+private:
+    bool ok = false;
+    std::size_t length = 0;
+#ifdef EDP_MMAP
+    const char* mapped = nullptr;
+#else
+    std::vector<char> copy;
+#endif
+};
+
+// File bornée sans verrou à plusieurs producteurs et plusieurs consommateurs (algorithme de D. Vyukov).
+// Chaque case porte un numéro de séquence qui indique si elle est libre pour l'écriture ou prête pour la lecture.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) { // capacity est arrondie à la puissance de 2 supérieure
+        std::size_t size = 2;
+        while (size < capacity) size *= 2;
+        mask = size - 1;
+        cells.reset(new Cell[size]);
+        for (std::size_t i = 0; i < size; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool tryPush(const T& value) {
+        std::size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // File pleine
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value) {
+        std::size_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value); // La case ne garde pas de copie (pointeurs partagés du mode service)
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // File vide
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void push(const T& value) {
+        unsigned spins = 0;
+        while (!tryPush(value)) backoff(spins);
+    }
+    T pop() {
+        T value;
+        unsigned spins = 0;
+        while (!tryPop(value)) backoff(spins);
+        return value;
+    }
+
+    // Attente active courte puis sommeil bref : un étage inactif ne prend pas le processeur aux threads de calcul
+    static void backoff(unsigned& spins) {
+        if (++spins < 64) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask;
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+// Mode batch en trois étages reliés par des files bornées sans verrou :
+//  - un thread de lecture projette le fichier en mémoire et découpe les contrats en blocs,
+//  - un groupe de threads de calcul (un pricer chacun, buffers réutilisés) calcule les blocs,
+//  - un thread d'écriture remet les blocs dans l'ordre du fichier, les formate et les écrit en un seul appel par bloc.
+// Les blocs circulent par pointeur et sont recyclés : la mémoire utilisée reste bornée quelle que soit la taille du fichier.
+// L'entrée est reconnue comme binaire par son en-tête "EDPC", sinon elle est lue en CSV. Les lignes invalides sont signalées
+// sur la sortie d'erreur et donnent des résultats NaN (une ligne illisible compte pour un contrat NaN, sauf la première, prise pour l'en-tête).
+static int runBatchFile(const std::string& inputPath, const std::string& outputPath, bool binaryOutput, const FiniteDifferencePricer::GridSettings& grid, Engine engine, unsigned threads) {
+    typedef FiniteDifferencePricer P;
+    const std::size_t chunkSize = engine == Engine::Gpu ? 65536 : 4096; // Le GPU reçoit plusieurs lots par bloc pour recouvrir les transferts
+
+    struct Chunk {
+        std::size_t sequence;
+        std::vector<P::Parameters> contracts;
+        P::BatchResult results;
+        P::BatchResult reference; // Formule fermée (mode validate)
+    };
+
+    MappedFile input(inputPath);
+    if (!input.valid()) {
+        std::cerr << "Erreur : impossible d'ouvrir " << inputPath << ".\n";
+        return 1;
+    }
+    const char* data = input.data();
+    const std::size_t size = input.size();
+    const bool binaryInput = size >= sizeof(BinaryHeader) && std::memcmp(data, contractMagic, 4) == 0;
+    if (binaryInput) {
+        BinaryHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        const bool supported = (header.version == binaryVersion && header.recordSize == sizeof(P::Parameters))
+                            || (header.version == 1 && header.recordSize == legacyContractSize);
+        if (!supported) {
+            std::cerr << "Erreur : version ou taille d'enregistrement non supportée dans " << inputPath << ".\n";
+            return 1;
+        }
+    }
+
+    std::ofstream file;
+    if (!outputPath.empty()) {
+        file.open(outputPath, std::ios::binary);
+        if (!file) {
+            std::cerr << "Erreur : impossible de créer " << outputPath << ".\n";
+            return 1;
+        }
+    }
+    std::ostream& output = outputPath.empty() ? std::cout : file;
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+#ifdef EDP_GPU
+    std::unique_ptr<GpuBatchPricer> gpu;
+    if (engine == Engine::Gpu) {
+        gpu.reset(new GpuBatchPricer(grid));
+        if (const char* e = gpu->error()) {
+            std::cerr << e << "\n";
+            return 1;
+        }
+        threads = 1; // Un seul thread alimente le GPU ; le parallélisme est dans les lots
+    }
+#endif
+    const std::size_t inFlight = 2 * threads + 2; // Nombre de blocs en circulation
+    std::vector<Chunk> chunks(inFlight);
+    BoundedQueue<Chunk*> freeChunks(inFlight), toPrice(inFlight), toWrite(inFlight);
+    for (Chunk& c : chunks) {
+        c.contracts.reserve(chunkSize);
+        freeChunks.push(&c);
+    }
+
+    std::atomic<std::size_t> chunkCount{0};
+    std::atomic<bool> parsed{false};
+
+    std::thread parser([&] {
+        std::size_t sequence = 0;
+        Chunk* chunk = freeChunks.pop();
+        auto emit = [&](bool last) {
+            if (chunk->contracts.empty() && !last) return;
+            if (!chunk->contracts.empty()) {
+                chunk->sequence = sequence++;
+                toPrice.push(chunk);
+                if (!last) chunk = freeChunks.pop();
+            } else {
+                freeChunks.push(chunk);
+            }
+            if (!last) chunk->contracts.clear();
+        };
+        auto add = [&](const P::Parameters& p) {
+            chunk->contracts.push_back(p);
+            if (chunk->contracts.size() == chunkSize) emit(false);
+        };
+
+        if (binaryInput) {
+            BinaryHeader header;
+            std::memcpy(&header, data, sizeof(header));
+            const std::size_t recordSize = header.recordSize; // Version 1 : les 6 premiers doubles, q = 0
+            const std::size_t count = (size - sizeof(BinaryHeader)) / recordSize;
+            const char* records = data + sizeof(BinaryHeader);
+            for (std::size_t i = 0; i < count; i++) {
+                P::Parameters p;
+                std::memcpy(&p, records + i * recordSize, recordSize);
+                if (const char* e = P::parameterError(p)) std::cerr << "Enregistrement " << i << " : " << e << "\n";
+                add(p);
+            }
+        } else {
+            const char* pos = data;
+            const char* end = data + size;
+            long lineNumber = 0;
+            bool first = true;
+            while (pos < end) {
+                const char* eol = static_cast<const char*>(std::memchr(pos, '\n', static_cast<std::size_t>(end - pos)));
+                if (!eol) eol = end;
+                const char* lineBegin = pos;
+                const char* lineEnd = eol;
+                pos = eol + 1;
+                lineNumber++;
+                while (lineBegin < lineEnd && (*lineBegin == ' ' || *lineBegin == '\t')) lineBegin++;
+                while (lineEnd > lineBegin && (lineEnd[-1] == '\r' || lineEnd[-1] == ' ' || lineEnd[-1] == '\t')) lineEnd--;
+                if (lineBegin == lineEnd || *lineBegin == '#') continue;
+                P::Parameters p{};
+                if (!parseContractLine(lineBegin, lineEnd, p)) {
+                    if (!first) { // Contrat NaN à sa place : le rang de chaque résultat reste celui de son contrat (sortie binaire sans colonnes de contrat)
+                        std::cerr << "Ligne " << lineNumber << " : format invalide (attendu : type,S0,K,r,sigma,T[,q]).\n";
+                        const double nan = std::numeric_limits<double>::quiet_NaN();
+                        add(P::Parameters{nan, nan, nan, nan, nan, nan, nan});
+                    }
+                    first = false; // La première ligne non lisible est l'en-tête
+                    continue;
+                }
+                first = false;
+                if (const char* e = P::parameterError(p)) std::cerr << "Ligne " << lineNumber << " : " << e << "\n";
+                add(p);
+            }
+        }
+        emit(true);
+        chunkCount.store(sequence, std::memory_order_relaxed);
+        parsed.store(true, std::memory_order_release);
+        for (unsigned t = 0; t < threads; t++) toPrice.push(nullptr); // Un signal de fin par thread de calcul
+    });
+
+    P::GridSettings contractGrid = grid;
+    contractGrid.concurrentLevels = false; // Les contrats sont déjà répartis sur les threads
+    contractGrid.threads = 1;
+    const AnalyticPricer analytic(grid.kernel);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            std::unique_ptr<P> pricer;
+            for (Chunk* chunk = toPrice.pop(); chunk; chunk = toPrice.pop()) {
+                const std::size_t n = chunk->contracts.size();
+                chunk->results.assign(n, 0.0);
+#ifdef EDP_GPU
+                if (engine == Engine::Gpu) {
+                    gpu->priceRange(chunk->contracts.data(), n, chunk->results, 0);
+                } else
+#endif
+                if (engine == Engine::Analytic) {
+                    analytic.priceRange(chunk->contracts.data(), n, chunk->results, 0);
+                } else {
+                    if (!pricer) pricer.reset(new P(chunk->contracts[0]));
+                    for (std::size_t i = 0; i < n; i++) chunk->results.store(i, pricer->price(chunk->contracts[i], contractGrid));
+                }
+                if (engine == Engine::Validate) {
+                    chunk->reference.assign(n, 0.0);
+                    analytic.priceRange(chunk->contracts.data(), n, chunk->reference, 0);
+                }
+                toWrite.push(chunk);
+            }
+        });
+    }
+
+    std::thread writer([&] {
+        std::vector<Chunk*> pending; // Blocs arrivés avant leur tour, indexés par numéro de séquence modulo inFlight
+        pending.assign(inFlight, nullptr);
+        std::string buffer;
+        if (binaryOutput) {
+            BinaryHeader header;
+            std::memcpy(header.magic, resultMagic, 4);
+            header.version = resultVersion;
+            header.recordSize = static_cast<std::uint32_t>(resultFields * sizeof(double));
+            header.reserved = 0;
+            buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        } else {
+            buffer = engine == Engine::Validate ? "type,S0,K,r,sigma,T,q,price,delta,gamma,theta,analytic,error\n"
+                                                : "type,S0,K,r,sigma,T,q,price,delta,gamma,theta\n";
+        }
+        std::size_t next = 0;
+        unsigned spins = 0;
+        for (;;) {
+            if (parsed.load(std::memory_order_acquire) && next == chunkCount.load(std::memory_order_relaxed)) break;
+            Chunk* chunk;
+            if (!toWrite.tryPop(chunk)) {
+                BoundedQueue<Chunk*>::backoff(spins);
+                continue;
+            }
+            spins = 0;
+            pending[chunk->sequence % inFlight] = chunk;
+            while (pending[next % inFlight] && pending[next % inFlight]->sequence == next) {
+                Chunk* c = pending[next % inFlight];
+                pending[next % inFlight] = nullptr;
+                const P::BatchResult& res = c->results;
+                for (std::size_t i = 0; i < c->contracts.size(); i++) {
+                    if (binaryOutput) {
+                        const double row[resultFields] = {res.price[i], res.delta[i], res.gamma[i], res.theta[i]};
+                        buffer.append(reinterpret_cast<const char*>(row), sizeof(row));
+                    } else {
+                        const P::Parameters& p = c->contracts[i];
+                        const double reference = engine == Engine::Validate ? c->reference.price[i] : 0.0;
+                        const double row[] = {p.type, p.S0, p.K, p.r, p.sigma, p.T, p.q, res.price[i], res.delta[i], res.gamma[i], res.theta[i], reference, res.price[i] - reference};
+                        const int fields = engine == Engine::Validate ? 13 : 11;
+                        for (int f = 0; f < fields; f++) {
+                            appendNumber(buffer, row[f]);
+                            buffer += f < fields - 1 ? ',' : '\n';
+                        }
+                    }
+                }
+                output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+                c->contracts.clear();
+                freeChunks.push(c); // Le bloc retourne au thread de lecture
+                next++;
+            }
+        }
+        if (!buffer.empty()) output.write(buffer.data(), static_cast<std::streamsize>(buffer.size())); // En-tête seul si le fichier est vide
+        output.flush();
+    });
+
+    parser.join();
+    for (std::thread& w : workers) w.join();
+    writer.join();
+    return output ? 0 : 1;
+}
+
+#ifdef EDP_SERVICE
+// Mode service (--serve [adresse:]port) : le programme reste à l'écoute et calcule les contrats reçus sur des connexions TCP.
+// Protocole binaire à trames de taille fixe (ordre des octets de la machine) : le client envoie un en-tête "EDPQ" puis ses requêtes,
+// le serveur répond par un en-tête "EDPA" puis une réponse par requête. Les réponses arrivent dans l'ordre où elles sont prêtes
+// (un contrat lu dans le cache passe avant ceux en cours de calcul) : l'identifiant relie chaque réponse à sa requête.
+struct ServiceRequest {
+    std::uint64_t id;
+    FiniteDifferencePricer::Parameters contract;
+    std::int32_t scheme; // Schéma (valeur de Scheme), -1 : celui du serveur
+    std::int32_t N; // 0 : celui du serveur, qui est aussi le plus grand N accepté
+};
+struct ServiceResponse {
+    std::uint64_t id;
+    std::uint32_t status; // serviceComputed, serviceCached ou serviceInvalid (résultats NaN)
+    std::uint32_t reserved;
+    double price, delta, gamma, theta;
+};
+static_assert(sizeof(ServiceRequest) == 72, "requête de 72 octets");
+static_assert(sizeof(ServiceResponse) == 48, "réponse de 48 octets");
+
+static const char requestMagic[4] = {'E', 'D', 'P', 'Q'};
+static const char responseMagic[4] = {'E', 'D', 'P', 'A'};
+static const std::uint32_t serviceVersion = 1;
+static const std::uint32_t serviceComputed = 0, serviceCached = 1, serviceInvalid = 2;
+static const std::size_t serviceBatchLimit = 1024; // Taille maximale d'un micro-lot
+static const int cacheMantissaBits = 32; // Bits de mantisse gardés par la clé du cache (écart relatif de 1e-10)
+
+// Cache LRU des résultats du mode service, partagé par toutes les connexions. La clé est le contrat quantifié (chaque double arrondi
+// à cacheMantissaBits bits de mantisse) avec le schéma et N de la requête ; les autres réglages de la grille sont ceux du serveur.
+class ResultCache {
+public:
+    struct Key {
+        std::uint64_t fields[7];
+        std::int32_t scheme;
+        std::int32_t N;
+        bool operator==(const Key& other) const { return std::memcmp(this, &other, sizeof(Key)) == 0; }
+    };
+
+    static Key makeKey(const FiniteDifferencePricer::Parameters& p, int scheme, int N) {
+        const double values[7] = {p.type, p.S0, p.K, p.r, p.sigma, p.T, p.q};
+        const std::uint64_t half = std::uint64_t(1) << (52 - cacheMantissaBits - 1);
+        Key key;
+        for (int i = 0; i < 7; i++) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &values[i], sizeof(bits));
+            key.fields[i] = (bits + half) & ~(2 * half - 1); // Arrondi au plus proche sur les bits gardés
+        }
+        key.scheme = scheme;
+        key.N = N;
+        return key;
+    }
+
+    explicit ResultCache(std::size_t capacity) : capacity(capacity) { index.reserve(capacity); }
+
+    bool find(const Key& key, double values[4]) {
+        if (capacity == 0) return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it == index.end()) return false;
+        entries.splice(entries.begin(), entries, it->second); // Le plus récemment servi passe en tête
+        std::memcpy(values, it->second->values, sizeof(it->second->values));
+        return true;
+    }
+
+    void insert(const Key& key, const double values[4]) {
+        if (capacity == 0) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            entries.splice(entries.begin(), entries, it->second);
+        } else {
+            if (entries.size() == capacity) { // Le moins récent est évincé et son noeud réutilisé
+                index.erase(entries.back().key);
+                entries.splice(entries.begin(), entries, std::prev(entries.end()));
+            } else {
+                entries.emplace_front();
+            }
+            entries.front().key = key;
+            it = index.emplace(key, entries.begin()).first;
+        }
+        std::memcpy(it->second->values, values, sizeof(it->second->values));
+    }
+
+private:
+    struct Entry {
+        Key key;
+        double values[4]; // price, delta, gamma, theta
+    };
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const { // FNV-1a sur les mots de la clé
+            std::uint64_t h = 14695981039346656037ull;
+            for (std::uint64_t f : key.fields) h = (h ^ f) * 1099511628211ull;
+            h = (h ^ static_cast<std::uint32_t>(key.scheme)) * 1099511628211ull;
+            h = (h ^ static_cast<std::uint32_t>(key.N)) * 1099511628211ull;
+            return static_cast<std::size_t>(h ^ (h >> 32));
+        }
+    };
+
+    std::size_t capacity;
+    std::mutex mutex;
+    std::list<Entry> entries; // Du plus récent au moins récent
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+};
+
+// Connexion d'un client. Le thread de lecture (réponses du cache) et le thread de réponse écrivent sur la même socket, d'où le verrou ;
+// la socket est fermée quand plus aucune requête en cours ne la référence.
+struct ServiceConnection {
+    explicit ServiceConnection(int fd) : fd(fd) {}
+    ~ServiceConnection() { ::close(fd); }
+    ServiceConnection(const ServiceConnection&) = delete;
+    ServiceConnection& operator=(const ServiceConnection&) = delete;
+
+    void send(const std::string& data) { // Un client parti ne fait qu'échouer l'écriture (SIGPIPE est ignoré)
+        std::lock_guard<std::mutex> lock(writing);
+        std::size_t done = 0;
+        while (done < data.size()) {
+            const ssize_t n = ::send(fd, data.data() + done, data.size() - done, 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return;
+            done += static_cast<std::size_t>(n);
+        }
+    }
+
+    const int fd;
+    std::mutex writing;
+};
+
+static bool receiveAll(int fd, void* data, std::size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        const ssize_t n = ::recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+static void appendResponse(std::string& out, std::uint64_t id, std::uint32_t status, const double values[4]) {
+    const ServiceResponse r = {id, status, 0, values[0], values[1], values[2], values[3]};
+    out.append(reinterpret_cast<const char*>(&r), sizeof(r));
+}
+
+// Le service en quatre étages, sur le modèle du mode batch :
+//  - un thread de lecture par connexion décode les requêtes, répond tout de suite aux contrats invalides et à ceux du cache,
+//    et place les autres dans la file d'entrée,
+//  - un thread de regroupement forme les micro-lots : un lot part quand window microsecondes se sont écoulées depuis sa première
+//    requête, ou dès qu'il atteint serviceBatchLimit contrats,
+//  - les threads de calcul (un pricer chacun) calculent les lots sans jamais toucher aux sockets,
+//  - un thread de réponse range les résultats dans le cache et écrit les réponses, une écriture par connexion et par lot.
+// Un client lent ou une connexion saturée ne bloque donc que son thread de lecture ou le thread de réponse, jamais le calcul.
+// Le serveur tourne jusqu'à ce qu'on l'arrête.
+static int runService(const std::string& address, const FiniteDifferencePricer::GridSettings& grid, Engine engine, unsigned threads, std::size_t cacheSize, double window) {
+    typedef FiniteDifferencePricer P;
+
+    std::string host = "127.0.0.1"; // Boucle locale par défaut : --serve 0.0.0.0:port pour écouter sur toutes les interfaces
+    std::string port = address;
+    const std::size_t colon = address.rfind(':');
+    if (colon != std::string::npos) {
+        host = address.substr(0, colon);
+        port = address.substr(colon + 1);
+    }
+    double portNumber;
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    if (!parseNumber(port, portNumber) || portNumber < 0 || portNumber > 65535 || portNumber != std::floor(portNumber)
+        || ::inet_pton(AF_INET, host.c_str(), &local.sin_addr) != 1) {
+        std::cerr << "Erreur : --serve attend un port ou adresse:port (IPv4).\n";
+        return 1;
+    }
+    local.sin_port = htons(static_cast<std::uint16_t>(portNumber));
+
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    const int on = 1;
+    if (listener < 0 || ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0
+        || ::bind(listener, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0 || ::listen(listener, 64) != 0) {
+        std::cerr << "Erreur : impossible d'écouter sur " << host << ":" << port << " (" << std::strerror(errno) << ").\n";
+        if (listener >= 0) ::close(listener);
+        return 1;
+    }
+    socklen_t localSize = sizeof(local);
+    ::getsockname(listener, reinterpret_cast<sockaddr*>(&local), &localSize); // Port choisi par le système si --serve 0
+    ::signal(SIGPIPE, SIG_IGN);
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    struct Pending {
+        ServiceRequest request;
+        ResultCache::Key key;
+        std::shared_ptr<ServiceConnection> connection;
+    };
+    struct Batch {
+        std::vector<Pending> items;
+        std::vector<ServiceResponse> responses;
+        std::vector<P::Parameters> contracts; // Moteur analytique
+        P::BatchResult results;
+    };
+
+    ResultCache cache(cacheSize);
+    BoundedQueue<Pending> incoming(4 * serviceBatchLimit);
+    const std::size_t inFlight = 2 * threads + 2; // Nombre de lots en circulation
+    std::vector<Batch> batches(inFlight);
+    BoundedQueue<Batch*> freeBatches(inFlight), toPrice(inFlight), toAnswer(inFlight);
+    for (Batch& b : batches) {
+        b.items.reserve(serviceBatchLimit);
+        freeBatches.push(&b);
+    }
+
+    std::thread([&] { // Regroupement
+        const auto span = std::chrono::duration<double, std::micro>(window);
+        std::chrono::steady_clock::time_point opened;
+        Batch* batch = freeBatches.pop();
+        unsigned spins = 0;
+        for (;;) {
+            Pending item;
+            if (incoming.tryPop(item)) {
+                spins = 0;
+                if (batch->items.empty()) opened = std::chrono::steady_clock::now();
+                batch->items.push_back(std::move(item));
+                if (batch->items.size() < serviceBatchLimit) continue;
+            } else if (batch->items.empty() || std::chrono::steady_clock::now() - opened < span) {
+                BoundedQueue<Pending>::backoff(spins);
+                continue;
+            }
+            toPrice.push(batch);
+            batch = freeBatches.pop();
+        }
+    }).detach();
+
+    P::GridSettings contractGrid = grid;
+    contractGrid.concurrentLevels = false; // Les contrats sont déjà répartis sur les threads
+    contractGrid.threads = 1;
+    const AnalyticPricer analytic(grid.kernel);
+    for (unsigned t = 0; t < threads; t++) {
+        std::thread([&] { // Calcul
+            std::unique_ptr<P> pricer;
+            P::GridSettings g = contractGrid;
+            for (;;) {
+                Batch* batch = toPrice.pop();
+                const std::size_t n = batch->items.size();
+                batch->responses.resize(n);
+                if (engine == Engine::Analytic) {
+                    batch->contracts.clear();
+                    for (const Pending& item : batch->items) batch->contracts.push_back(item.request.contract);
+                    batch->results.assign(n, 0.0);
+                    analytic.priceRange(batch->contracts.data(), n, batch->results, 0);
+                }
+                for (std::size_t i = 0; i < n; i++) {
+                    const ServiceRequest& req = batch->items[i].request;
+                    ServiceResponse& out = batch->responses[i];
+                    out.id = req.id;
+                    out.status = serviceComputed;
+                    out.reserved = 0;
+                    if (engine == Engine::Analytic) {
+                        out.price = batch->results.price[i];
+                        out.delta = batch->results.delta[i];
+                        out.gamma = batch->results.gamma[i];
+                        out.theta = batch->results.theta[i];
+                        continue;
+                    }
+                    g.scheme = req.scheme < 0 ? contractGrid.scheme : static_cast<P::Scheme>(req.scheme);
+                    g.N = req.N > 0 ? req.N : contractGrid.N;
+                    P::Result r;
+                    try { // Une allocation impossible ne fait échouer que son contrat : le thread est détaché, l'exception arrêterait le serveur
+                        if (!pricer) pricer.reset(new P(req.contract));
+                        r = pricer->price(req.contract, g);
+                    } catch (const std::exception&) {
+                        pricer.reset();
+                        r.price = r.delta = r.gamma = r.theta = std::numeric_limits<double>::quiet_NaN();
+                        out.status = serviceInvalid;
+                    }
+                    out.price = r.price;
+                    out.delta = r.delta;
+                    out.gamma = r.gamma;
+                    out.theta = r.theta;
+                }
+                toAnswer.push(batch);
+            }
+        }).detach();
+    }
+
+    std::thread([&] { // Réponse
+        std::vector<std::pair<ServiceConnection*, std::string>> outgoing; // Réponses du lot par connexion
+        for (;;) {
+            Batch* batch = toAnswer.pop();
+            for (std::size_t i = 0; i < batch->items.size(); i++) {
+                const Pending& item = batch->items[i];
+                const ServiceResponse& r = batch->responses[i];
+                const double values[4] = {r.price, r.delta, r.gamma, r.theta};
+                if (!std::isnan(r.price)) cache.insert(item.key, values);
+                auto it = std::find_if(outgoing.begin(), outgoing.end(), [&](const std::pair<ServiceConnection*, std::string>& o) { return o.first == item.connection.get(); });
+                if (it == outgoing.end()) it = outgoing.emplace(outgoing.end(), item.connection.get(), std::string());
+                it->second.append(reinterpret_cast<const char*>(&r), sizeof(r));
+            }
+            for (auto& o : outgoing) o.first->send(o.second);
+            outgoing.clear();
+            batch->items.clear(); // Libère les connexions terminées
+            freeBatches.push(batch);
+        }
+    }).detach();
+
+    char shown[INET_ADDRSTRLEN];
+    ::inet_ntop(AF_INET, &local.sin_addr, shown, sizeof(shown));
+    std::cerr << "Service en écoute sur " << shown << ":" << ntohs(local.sin_port) << " (" << threads << " threads de calcul, cache de "
+              << cacheSize << " résultats, lots de " << window << " us)\n";
+
+    for (;;) {
+        const int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::cerr << "Erreur : accept (" << std::strerror(errno) << ").\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Descripteurs épuisés : on laisse les connexions se fermer
+            continue;
+        }
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // Les réponses partent sans attendre d'être regroupées par TCP
+        std::shared_ptr<ServiceConnection> connection = std::make_shared<ServiceConnection>(fd);
+        std::thread([&, connection] { // Lecture d'une connexion
+            BinaryHeader header;
+            if (!receiveAll(connection->fd, &header, sizeof(header)) || std::memcmp(header.magic, requestMagic, 4) != 0
+                || header.version != serviceVersion || header.recordSize != sizeof(ServiceRequest)) return;
+            std::memcpy(header.magic, responseMagic, 4);
+            header.recordSize = sizeof(ServiceResponse);
+            header.reserved = 0;
+            connection->send(std::string(reinterpret_cast<const char*>(&header), sizeof(header)));
+
+            std::vector<char> buffer(256 * sizeof(ServiceRequest));
+            std::size_t filled = 0;
+            std::string immediate; // Réponses envoyées sans calcul, une écriture par lecture
+            for (;;) {
+                const ssize_t n = ::recv(connection->fd, buffer.data() + filled, buffer.size() - filled, 0);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) break;
+                filled += static_cast<std::size_t>(n);
+                const std::size_t count = filled / sizeof(ServiceRequest);
+                for (std::size_t i = 0; i < count; i++) {
+                    Pending item;
+                    std::memcpy(&item.request, buffer.data() + i * sizeof(ServiceRequest), sizeof(ServiceRequest));
+                    const ServiceRequest& req = item.request;
+                    double values[4];
+                    if (P::parameterError(req.contract) || P::barrierError(req.contract, grid) || req.scheme < -1
+                        || req.scheme > static_cast<int>(P::Scheme::CrankNicolson) || req.N < 0 || req.N == 1 || req.N > grid.N) {
+                        std::fill(values, values + 4, std::numeric_limits<double>::quiet_NaN());
+                        appendResponse(immediate, req.id, serviceInvalid, values);
+                        continue;
+                    }
+                    item.key = engine == Engine::Analytic ? ResultCache::makeKey(req.contract, -1, 0)
+                                                          : ResultCache::makeKey(req.contract, req.scheme < 0 ? static_cast<int>(grid.scheme) : req.scheme, req.N > 0 ? req.N : grid.N);
+                    if (cache.find(item.key, values)) {
+                        appendResponse(immediate, req.id, serviceCached, values);
+                        continue;
+                    }
+                    item.connection = connection;
+                    incoming.push(item);
+                }
+                if (!immediate.empty()) connection->send(immediate);
+                immediate.clear();
+                filled -= count * sizeof(ServiceRequest);
+                std::memmove(buffer.data(), buffer.data() + count * sizeof(ServiceRequest), filled);
+            }
+        }).detach();
+    }
+}
+#endif
+
+// Micro-benchmark du solveur : chaque combinaison (N, schéma, noyau) de la grille standard résout les contrats de référence
+// jusqu'à benchmarkSeconds de mesure, la solution étant oubliée entre deux résolutions ; les débits sont ceux du meilleur passage. --N, --M, --scheme et --kernel restreignent
+// la grille à une valeur ; les autres réglages (--grid, --interpolation...) s'appliquent à toutes les mesures.
+// Le débit mémoire est celui du modèle de trafic : chaque tableau du pas est lu ou écrit une fois par noeud (40 octets pour le stencil,
+// 56 pour la substitution de Thomas, 16 pour la copie d'un pas implicite ; en float ou en précision mixte, voir benchmarkBytes).
+// Les petites grilles tiennent en cache : c'est un débit effectif. La précision (--precision) fait partie de la clé des résultats.
+// Avec --baseline fichier.json (résultats d'une version précédente), chaque combinaison présente des deux côtés est comparée :
+// une résolution plus lente de plus de benchmarkSlowdown ou une erreur de prix qui augmente est signalée, et le code de retour vaut 2.
+static const double benchmarkSeconds = 0.25; // Durée minimale de mesure par combinaison
+static const double benchmarkSlowdown = 0.10;
+static const int benchmarkVersion = 1; // Version du schéma JSON
+static const FiniteDifferencePricer::Parameters benchmarkContracts[] = {{1, 100, 100, 0.05, 0.2, 1}, {0, 90, 100, 0.03, 0.3, 0.5}}; // Contrats de référence
+static const int benchmarkContractCount = 2;
+
+// Octets lus ou écrits par noeud intérieur et par pas selon le modèle de trafic de runBenchmark. Remontées float et mixte : coefficients
+// a, c, e en float et prix de 4 ou 8 octets ; un pas theta y enchaîne l'incrément (in, out), la substitution (trois tableaux de la
+// factorisation, quatre accès aux prix) et l'ajout de l'incrément aux prix (trois accès).
+static double benchmarkBytes(FiniteDifferencePricer::Scheme scheme, FiniteDifferencePricer::Precision precision) {
+    typedef FiniteDifferencePricer P;
+    if (precision == P::Precision::Double) return scheme == P::Scheme::Explicit ? 40.0 : (scheme == P::Scheme::Implicit ? 72.0 : 96.0);
+    const double value = precision == P::Precision::Float ? 4.0 : 8.0;
+    return scheme == P::Scheme::Explicit ? 12.0 + 2.0 * value : 24.0 + 9.0 * value;
+}
+
+struct BenchmarkEntry {
+    std::string key; // "N scheme kernel precision"
+    double seconds = 0.0;
+    double error = 0.0; // Plus grande erreur absolue sur les contrats de référence
+};
+
+// Relit les résultats écrits par runBenchmark (un résultat par ligne), sans analyseur JSON général
+static bool loadBenchmark(const std::string& path, std::vector<BenchmarkEntry>& entries) {
+    std::ifstream file(path);
+    if (!file) return false;
+    auto field = [](const std::string& line, const char* name) { // Position de la valeur de "name", npos si absente
+        const std::string key = std::string("\"") + name + "\": ";
+        const std::size_t at = line.find(key);
+        return at == std::string::npos ? at : at + key.size();
+    };
+    std::string line;
+    while (std::getline(file, line)) {
+        const std::size_t n = field(line, "N"), scheme = field(line, "scheme"), kernel = field(line, "kernel");
+        const std::size_t seconds = field(line, "seconds_per_solve"), errors = field(line, "errors");
+        if (n == std::string::npos || scheme == std::string::npos || kernel == std::string::npos || seconds == std::string::npos || errors == std::string::npos) continue;
+        BenchmarkEntry e;
+        const std::size_t precision = field(line, "precision"); // Absente des résultats antérieurs à --precision : double
+        e.key = line.substr(n, line.find(',', n) - n) + " " + line.substr(scheme + 1, line.find('"', scheme + 1) - scheme - 1)
+              + " " + line.substr(kernel + 1, line.find('"', kernel + 1) - kernel - 1)
+              + " " + (precision == std::string::npos ? std::string("double") : line.substr(precision + 1, line.find('"', precision + 1) - precision - 1));
+        e.seconds = std::strtod(line.c_str() + seconds, nullptr);
+        const char* pos = line.c_str() + errors + 1; // Après le [
+        while (*pos && *pos != ']') {
+            char* end = nullptr;
+            const double v = std::strtod(pos, &end);
+            if (end == pos) break;
+            e.error = std::max(e.error, std::abs(v));
+            pos = end;
+            while (*pos == ',' || *pos == ' ') pos++;
+        }
+        entries.push_back(e);
+    }
+    return true;
+}
+
+static int runBenchmark(const Options& options, const FiniteDifferencePricer::GridSettings& base) {
+    typedef FiniteDifferencePricer P;
+    const P::Parameters* contracts = benchmarkContracts;
+    const int contractCount = benchmarkContractCount;
+    std::vector<int> sizes = {100, 500, 2000};
+    if (options.count("N")) sizes.assign(1, base.N);
+    std::vector<P::Scheme> schemes = {P::Scheme::Explicit, P::Scheme::Implicit, P::Scheme::CrankNicolson};
+    if (options.count("scheme")) schemes.assign(1, base.scheme);
+    std::vector<P::Kernel> kernels;
+    for (P::Kernel k : {P::Kernel::Scalar, P::Kernel::AVX2, P::Kernel::AVX512, P::Kernel::NEON}) {
+        if (P::kernelSupported(k) && (base.kernel == P::Kernel::Auto || base.kernel == k)) kernels.push_back(k);
+    }
+    const char* schemeNames[] = {"explicit", "implicit", "cn"};
+
+    const AnalyticPricer analytic;
+    double reference[contractCount];
+    for (int c = 0; c < contractCount; c++) reference[c] = analytic.price(contracts[c]).price;
+
+    std::string json = "{\n  \"version\": ";
+    appendNumber(json, benchmarkVersion);
+#ifdef __VERSION__
+    json += ",\n  \"compiler\": \"" __VERSION__ "\"";
+#endif
+    json += ",\n  \"contracts\": [";
+    for (int c = 0; c < contractCount; c++) {
+        const P::Parameters& p = contracts[c];
+        const double fields[] = {p.type, p.S0, p.K, p.r, p.sigma, p.T};
+        const char* names[] = {"type", "S0", "K", "r", "sigma", "T"};
+        json += c ? ", {" : "{";
+        for (int f = 0; f < 6; f++) {
+            json += f ? ", \"" : "\"";
+            json += names[f];
+            json += "\": ";
+            appendNumber(json, fields[f]);
+        }
+        json += "}";
+    }
+    json += "],\n  \"results\": [";
+
+    std::vector<BenchmarkEntry> measured;
+    bool first = true;
+    for (int n : sizes) {
+        for (P::Scheme scheme : schemes) {
+            for (P::Kernel kernel : kernels) {
+                P::GridSettings grid = base;
+                grid.N = n;
+                grid.scheme = scheme;
+                grid.kernel = kernel;
+                grid.sensitivities = false;
+                P pricer(contracts[0]);
+                double errors[contractCount];
+                int steps[contractCount];
+                long long updates = 0; // Noeuds intérieurs mis à jour par un passage sur les contrats
+                double bytes = 0.0;
+                for (int c = 0; c < contractCount; c++) { // Passage de chauffe : buffers dimensionnés, erreurs et tailles des grilles
+                    errors[c] = pricer.price(contracts[c], grid).price - reference[c];
+                    pricer.discardSolution();
+                    const long long m = steps[c] = pricer.timeSteps();
+                    updates += m * (n - 1);
+                    bytes += benchmarkBytes(scheme, base.precision) * m * (n - 1);
+                }
+                int passes = 0;
+                double elapsed = 0.0, best = std::numeric_limits<double>::infinity(); // Meilleur passage : le moins perturbé par la machine
+                do {
+                    const auto start = std::chrono::steady_clock::now();
+                    for (int c = 0; c < contractCount; c++) {
+                        pricer.price(contracts[c], grid);
+                        pricer.discardSolution();
+                    }
+                    const double pass = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    best = std::min(best, pass);
+                    elapsed += pass;
+                    passes++;
+                } while (elapsed < benchmarkSeconds || passes < 3);
+
+                const double perSolve = best / contractCount;
+                BenchmarkEntry entry;
+                entry.key = std::to_string(n) + " " + schemeNames[static_cast<int>(scheme)] + " " + P::kernelName(pricer.selectedKernel())
+                          + " " + P::precisionName(base.precision);
+                entry.seconds = perSolve;
+                for (int c = 0; c < contractCount; c++) entry.error = std::max(entry.error, std::abs(errors[c]));
+                measured.push_back(entry);
+                json += first ? "\n    {" : ",\n    {";
+                first = false;
+                json += "\"N\": ";
+                appendNumber(json, n);
+                json += ", \"scheme\": \"";
+                json += schemeNames[static_cast<int>(scheme)];
+                json += "\", \"kernel\": \"";
+                json += P::kernelName(pricer.selectedKernel());
+                json += "\", \"precision\": \"";
+                json += P::precisionName(base.precision);
+                json += "\", \"solves\": ";
+                appendNumber(json, passes * contractCount);
+                json += ", \"seconds_per_solve\": ";
+                appendNumber(json, perSolve);
+                json += ", \"node_updates_per_second\": ";
+                appendNumber(json, updates / best);
+                json += ", \"bandwidth_gb_per_second\": ";
+                appendNumber(json, bytes / best * 1e-9);
+                json += ", \"M\": [";
+                for (int c = 0; c < contractCount; c++) { // Par contrat, dans l'ordre de "contracts" (M automatique : il dépend de T)
+                    if (c) json += ", ";
+                    appendNumber(json, steps[c]);
+                }
+                json += "], \"errors\": [";
+                for (int c = 0; c < contractCount; c++) {
+                    if (c) json += ", ";
+                    appendNumber(json, errors[c]);
+                }
+                json += "]}";
+            }
+        }
+    }
+    json += "\n  ]\n}\n";
+
+    auto it = options.find("output");
+    if (it == options.end()) {
+        std::cout << json;
+    } else {
+        std::ofstream file(it->second, std::ios::binary);
+        if (!file || !file.write(json.data(), static_cast<std::streamsize>(json.size()))) {
+            std::cerr << "Erreur : impossible d'écrire " << it->second << ".\n";
+            return 1;
+        }
+    }
+
+    it = options.find("baseline");
+    if (it == options.end()) return 0;
+    std::vector<BenchmarkEntry> baseline;
+    if (!loadBenchmark(it->second, baseline)) {
+        std::cerr << "Erreur : impossible de lire " << it->second << ".\n";
+        return 1;
+    }
+    int regressions = 0;
+    for (const BenchmarkEntry& e : measured) {
+        const auto old = std::find_if(baseline.begin(), baseline.end(), [&](const BenchmarkEntry& b) { return b.key == e.key; });
+        if (old == baseline.end()) continue;
+        if (e.seconds > old->seconds * (1.0 + benchmarkSlowdown)) {
+            std::cerr << "Régression (" << e.key << ") : " << e.seconds << " s par résolution contre " << old->seconds << " s.\n";
+            regressions++;
+        }
+        if (e.error > old->error * (1.0 + 1e-9) + 1e-15) { // Tolérance des arrondis seulement : la précision ne doit pas bouger
+            std::cerr << "Régression (" << e.key << ") : erreur de prix " << e.error << " contre " << old->error << ".\n";
+            regressions++;
+        }
+    }
+    return regressions ? 2 : 0;
+}
+
+// Rapport de validation des remontées float et mixte (--precision-report) : pour chaque N de la grille standard et chaque schéma
+// (restreints par --N et --scheme, les autres réglages s'appliquant à tous les calculs), plus grands écarts au calcul en double du prix
+// et des Grecques sur les contrats de référence de --bench. Une ligne CSV par combinaison (N, schéma, précision).
+static int runPrecisionReport(const Options& options, const FiniteDifferencePricer::GridSettings& base) {
+    typedef FiniteDifferencePricer P;
+    std::vector<int> sizes = {100, 500, 2000};
+    if (options.count("N")) sizes.assign(1, base.N);
+    std::vector<P::Scheme> schemes = {P::Scheme::Explicit, P::Scheme::Implicit, P::Scheme::CrankNicolson};
+    if (options.count("scheme")) schemes.assign(1, base.scheme);
+    const char* schemeNames[] = {"explicit", "implicit", "cn"};
+
+    std::string csv = "N,scheme,precision,M,price_error,relative_price_error,delta_error,gamma_error,theta_error\n";
+    for (int n : sizes) {
+        for (P::Scheme scheme : schemes) {
+            P::GridSettings grid = base;
+            grid.N = n;
+            grid.scheme = scheme;
+            grid.sensitivities = false;
+            grid.precision = P::Precision::Double;
+            P pricer(benchmarkContracts[0]);
+            P::Result exact[benchmarkContractCount];
+            int steps = 0;
+            for (int c = 0; c < benchmarkContractCount; c++) {
+                exact[c] = pricer.price(benchmarkContracts[c], grid);
+                steps = std::max(steps, pricer.timeSteps());
+            }
+            for (P::Precision precision : {P::Precision::Float, P::Precision::Mixed}) {
+                grid.precision = precision;
+                double errors[5] = {0.0, 0.0, 0.0, 0.0, 0.0}; // Prix, prix relatif, Delta, Gamma, Theta
+                for (int c = 0; c < benchmarkContractCount; c++) {
+                    const P::Result r = pricer.price(benchmarkContracts[c], grid);
+                    const P::Result& e = exact[c];
+                    const double gaps[5] = {r.price - e.price, (r.price - e.price) / e.price, r.delta - e.delta, r.gamma - e.gamma, r.theta - e.theta};
+                    for (int k = 0; k < 5; k++) errors[k] = std::max(errors[k], std::abs(gaps[k]));
+                }
+                appendNumber(csv, n);
+                csv += ",";
+                csv += schemeNames[static_cast<int>(scheme)];
+                csv += ",";
+                csv += P::precisionName(precision);
+                csv += ",";
+                appendNumber(csv, steps);
+                for (double e : errors) {
+                    csv += ",";
+                    appendNumber(csv, e);
+                }
+                csv += "\n";
+            }
+        }
+    }
+
+    auto it = options.find("output");
+    if (it == options.end()) {
+        std::cout << csv;
+        return 0;
+    }
+    std::ofstream file(it->second, std::ios::binary);
+    if (!file || !file.write(csv.data(), static_cast<std::streamsize>(csv.size()))) {
+        std::cerr << "Erreur : impossible d'écrire " << it->second << ".\n";
+        return 1;
+    }
+    return 0;
+}
+
+static void printStats(const FiniteDifferencePricer::PricingStats& s) { // Compteurs de --stats, sur la sortie d'erreur pour ne pas mêler les résultats
+    typedef FiniteDifferencePricer P;
+    std::cerr << "Résolutions : " << s.solves << ", pas de temps : " << s.timeSteps << ", noeuds calculés : " << s.nodeUpdates << "\n";
+    std::cerr << "dt / dt_stabilité : " << s.stabilityRatio << "\n";
+    for (int i = 0; i < static_cast<int>(P::Phase::Count); i++) {
+        std::cerr << "Temps " << P::phaseName(static_cast<P::Phase>(i)) << " : " << s.seconds[i] * 1e3 << " ms\n";
+    }
+    std::cerr << "Temps total : " << s.totalSeconds() * 1e3 << " ms\n";
+}
+
+static int runCommandLine(int argc, char** argv) {
+    typedef FiniteDifferencePricer P;
+    Options options;
+    if (!parseCommandLine(argc, argv, options)) return 1;
+    if (options.count("help")) {
+        printUsage();
+        return 0;
+    }
+
+    P::GridSettings grid;
+    if (!buildGridSettings(options, grid)) return 1;
+    if (options.count("bench")) return runBenchmark(options, grid);
+    if (options.count("precision-report")) return runPrecisionReport(options, grid);
+
+    Engine engine = Engine::FiniteDifference;
+    if (options.count("engine")) {
+        const std::string& name = options["engine"];
+        if (name == "analytic") engine = Engine::Analytic;
+        else if (name == "validate") engine = Engine::Validate;
+        else if (name == "gpu") engine = Engine::Gpu;
+        else if (name != "fd") { std::cerr << "Erreur : moteur inconnu : " << name << "\n"; return 1; }
+    }
+    if (engine == Engine::Gpu) {
+#ifdef EDP_GPU
+        if (const char* e = GpuBatchPricer::gridError(grid)) {
+            std::cerr << e << "\n";
+            return 1;
+        }
+        if (!options.count("batch")) {
+            std::cerr << "Erreur : le moteur GPU calcule des portefeuilles (--batch).\n";
+            return 1;
+        }
+#else
+        std::cerr << "Erreur : --engine gpu demande un programme compilé par nvcc (nvcc -x cu code.cpp).\n";
+        return 1;
+#endif
+    }
+    if ((engine == Engine::Analytic || engine == Engine::Validate) && (grid.exercise != P::Exercise::European || grid.payoff != P::Payoff::Vanilla || !grid.market.empty())) {
+        std::cerr << "Erreur : la formule fermée ne couvre que le call et le put européens classiques à r et sigma constants (--engine fd).\n";
+        return 1;
+    }
+
+    double threads = 0;
+    if (options.count("threads") && (!parseNumber(options["threads"], threads) || threads < 0)) {
+        std::cerr << "Erreur : --threads doit être un entier positif.\n";
+        return 1;
+    }
+    if (options.count("serve")) {
+        double cacheSize = 100000, window = 200;
+        if (options.count("cache") && (!parseNumber(options["cache"], cacheSize) || cacheSize < 0)) {
+            std::cerr << "Erreur : --cache doit être un entier positif.\n";
+            return 1;
+        }
+        if (options.count("window") && (!parseNumber(options["window"], window) || window < 0)) {
+            std::cerr << "Erreur : --window doit être un nombre positif de microsecondes.\n";
+            return 1;
+        }
+        if (engine != Engine::FiniteDifference && engine != Engine::Analytic) {
+            std::cerr << "Erreur : --serve calcule avec --engine fd ou analytic.\n";
+            return 1;
+        }
+#ifdef EDP_SERVICE
+        return runService(options["serve"], grid, engine, static_cast<unsigned>(threads), static_cast<std::size_t>(cacheSize), window);
+#else
+        std::cerr << "Erreur : --serve demande un système POSIX (sockets).\n";
+        return 1;
+#endif
+    }
+    if (options.count("batch")) {
+        const std::string format = options.count("format") ? options["format"] : "csv";
+        if (format != "csv" && format != "binary") {
+            std::cerr << "Erreur : format de sortie inconnu : " << format << "\n";
+            return 1;
+        }
+        if (format == "binary" && engine == Engine::Validate) {
+            std::cerr << "Erreur : --engine validate n'existe qu'avec --format csv (colonnes analytic et error).\n";
+            return 1;
+        }
+        return runBatchFile(options["batch"], options.count("output") ? options["output"] : "", format == "binary", grid, engine, static_cast<unsigned>(threads));
+    }
+
+    if ((options.count("stats") || options.count("trace")) && !P::instrumented) {
+        std::cerr << "Erreur : --stats et --trace demandent un programme compilé avec -DEDP_INSTRUMENTATION.\n";
+        return 1;
+    }
+    if ((options.count("stats") || options.count("trace")) && engine == Engine::Analytic) {
+        std::cerr << "Erreur : --stats et --trace mesurent les différences finies (--engine fd ou validate).\n";
+        return 1;
+    }
+
+    if (options.count("snapshot-times") && !options.count("snapshot")) {
+        std::cerr << "Erreur : --snapshot-times précise les niveaux de --snapshot.\n";
+        return 1;
+    }
+    if (options.count("snapshot") && (engine == Engine::Analytic || grid.richardson > 1 || grid.tolerance > 0)) {
+        std::cerr << "Erreur : --snapshot enregistre une seule grille des différences finies (sans --engine analytic, --richardson ni --tolerance).\n";
+        return 1;
+    }
+
+    P::Parameters params{};
+    if (!buildParameters(options, params)) return 1;
+    if (const char* e = P::barrierError(params, grid)) {
+        std::cerr << e << "\n";
+        return 1;
+    }
+    if (std::any_of(grid.snapshotTimes.begin(), grid.snapshotTimes.end(), [&](double t) { return t >= params.T; })) {
+        std::cerr << "Erreur : les dates de --snapshot-times doivent être antérieures à la maturité T.\n";
+        return 1;
+    }
+    const AnalyticPricer analytic(grid.kernel);
+    if (engine == Engine::Analytic) {
+        if (options.count("surface")) {
+            std::cerr << "Erreur : --surface demande la grille des différences finies (--engine fd).\n";
+            return 1;
+        }
+        const P::Result res = analytic.price(params);
+        std::cout << "Prix de l'option : " << res.price << "\n";
+        std::cout << "Delta : " << res.delta << "\n";
+        std::cout << "Gamma : " << res.gamma << "\n";
+        std::cout << "Theta : " << res.theta << "\n";
+        std::cout << "Vega : " << res.vega << "\n";
+        std::cout << "Rho : " << res.rho << "\n";
+        return 0;
+    }
+    if (options.count("threads")) grid.threads = static_cast<int>(threads); // Un seul contrat : les threads se partagent la grille
+    P pricer(params);
+    P::Result res = pricer.price(params, grid);
+    std::cout << "Prix de l'option : " << res.price << "\n";
+    std::cout << "Delta : " << res.delta << "\n";
+    std::cout << "Gamma : " << res.gamma << "\n";
+    std::cout << "Theta : " << res.theta << "\n";
+    if (!std::isnan(res.errorEstimate)) std::cout << "Erreur estimée : " << res.errorEstimate << "\n";
+    if (engine == Engine::Validate) {
+        const P::Result reference = analytic.price(params);
+        std::cout << "Prix analytique : " << reference.price << "\n";
+        std::cout << "Écart FD - analytique : " << res.price - reference.price << "\n";
+        std::cout << "Écart Delta : " << res.delta - reference.delta << "\n";
+        std::cout << "Écart Gamma : " << res.gamma - reference.gamma << "\n";
+    }
+    if (options.count("stats")) printStats(pricer.stats());
+    if (options.count("trace") && !pricer.writeTrace(options["trace"])) {
+        std::cerr << "Erreur : impossible de créer " << options["trace"] << ".\n";
+        return 1;
+    }
+
+    if (options.count("snapshot") && !pricer.writeSnapshot(options["snapshot"])) {
+        std::cerr << "Erreur : impossible de créer " << options["snapshot"] << ".\n";
+        return 1;
+    }
+
+    if (options.count("surface")) {
+        std::ofstream file(options["surface"]);
+        if (!file) {
+            std::cerr << "Erreur : impossible de créer " << options["surface"] << ".\n";
+            return 1;
+        }
+        P::GreeksSurface g = pricer.greeksSurface();
+        std::string buffer = "S,price,delta,gamma,theta\n";
+        for (std::size_t i = 0; i < g.S.size(); i++) {
+            const double row[] = {g.S[i], g.price[i], g.delta[i], g.gamma[i], g.theta[i]};
+            for (int f = 0; f < 5; f++) {
+                appendNumber(buffer, row[f]);
+                buffer += f < 4 ? ',' : '\n';
+            }
+        }
+        file << buffer;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) return runCommandLine(argc, argv);
     FiniteDifferencePricer::Parameters params{100.0, 135.0, 0.05, 0.2, 1.0}; // Configuration par défaut
     FiniteDifferencePricer pricer(params);
     pricer.run();